@@ -11,6 +11,7 @@
 #include "unionfind.h"
 #include "group.h"
 #include "action.h"
+#include "group_cache.h"
 
 // ----------------------------------------------------------------
 
@@ -18,6 +19,16 @@ NaturalAction::domain_type NaturalAction::domain() const {
 	return range( 0, group()->degree() );
 }
 
+std::vector<std::vector<NaturalAction::value_type>> NaturalAction::calculateOrbits() const {
+	GroupCache::Key key( group()->generators(), group()->degree() );
+	auto cached = GroupCache::global().orbits( key );
+	if( cached )
+		return *cached;
+	auto r = PointAction<NaturalAction,NaturalAction::value_type,NaturalAction::domain_type>::calculateOrbits();
+	GroupCache::global().storeOrbits( key, std::make_shared<const std::vector<std::vector<value_type>>>( r ) );
+	return r;
+}
+
 Group NaturalAction::anonymize() const {
 	return group();
 }
@@ -29,8 +29,8 @@ class RestrictedNaturalSetAction;
 template<typename A, typename value_type, typename domain_type>
 class Action {
 	Group _group;
-	mutable std::vector<std::vector<value_type>> _orbits;
-	mutable Group _kernel;
+	Lazy<std::vector<std::vector<value_type>>> _orbits;
+	Lazy<Group> _kernel;
 public:
 	// returns a shared reference to the group
 	Group group() const;
@@ -53,9 +53,12 @@ public:
 	// checks whether the action is trivial
 	bool isTrivial() const;
 
-	// computes the kernel of the action (stabiliser)
+	// returns the kernel of the action (stabiliser) (cached)
 	Group kernel() const;
 
+	// computes the kernel of the action, in time polynomial in the degree and the size of the domain
+	Group calculateKernel() const;
+
 	// computes a system of imprimitivity on which the group acts (Atkinson)
 	RestrictedNaturalSetAction systemOfImprimitivity() const;
 
@@ -93,6 +96,9 @@ public:
 	// returns the domain
 	domain_type domain() const;
 
+	// computes the orbits, shared through the GroupCache between equal groups
+	std::vector<std::vector<value_type>> calculateOrbits() const;
+
 	Group anonymize() const;
 
 	// constructor
@@ -188,9 +194,7 @@ Group Action<A,value_type,domain_type>::group() const {
 
 template<typename A, typename value_type, typename domain_type>
 const std::vector<std::vector<value_type>>& Action<A,value_type,domain_type>::orbits() const {
-	if( _orbits.size() == 0 )
-		_orbits = static_cast<const A*>(this)->calculateOrbits();
-	return _orbits;
+	return _orbits.get( [this]() { return static_cast<const A*>(this)->calculateOrbits(); } );
 }
 
 template<typename A, typename value_type, typename domain_type>
@@ -276,17 +280,43 @@ T Action<A,value_type,domain_type>::orbit( value_type seed ) const {
 
 template<typename A, typename value_type, typename domain_type>
 Group Action<A,value_type,domain_type>::kernel() const {
-	// warning: brute-force computation. Needs step by set computation for polynomial time
-	if( _kernel )
-		return _kernel;
-	const auto& d = static_cast<const A*>( this )->domain();
-	_kernel.reset( new Subgroup( group(), [d,this](const Permutation& sigma)->bool { 
-		for( const auto& x : d ) 
-			if( operator()( sigma, x ) != x ) 
-				return false; 
-		return true; 
-	} ) );
-	return _kernel;
+	return _kernel.get( [this]() { return calculateKernel(); } );
+}
+
+template<typename A, typename value_type, typename domain_type>
+Group Action<A,value_type,domain_type>::calculateKernel() const {
+	// the group acts faithfully on the disjoint union of its points and the domain, and the kernel is the
+	// pointwise stabiliser of the domain there. it suffices to fix a base of the image of the action,
+	// so the kernel is read off a stabilizer chain whose base starts with one
+	int n = group()->degree();
+	std::map<value_type,int> index;
+	for( const auto& x : static_cast<const A*>( this )->domain() )
+		index.emplace( x, index.size() );
+	int m = index.size();
+	std::vector<Permutation> combined, image;
+	for( const Permutation& sigma : group()->generators() ) {
+		std::vector<int> c( n + m ), d( m );
+		for( int x = 0; x < n; ++x )
+			c[x] = sigma( x );
+		for( const auto& y : index ) {
+			d[y.second] = index.at( operator()( sigma, y.first ) );
+			c[n + y.second] = n + d[y.second];
+		}
+		combined.emplace_back( std::move( c ) );
+		image.emplace_back( std::move( d ) );
+	}
+	std::vector<int> base;
+	if( m > 0 )
+		for( int b : StabilizerChain( image, m ).base() )
+			base.push_back( n + b );
+	std::vector<Permutation> generators;
+	for( const Permutation& sigma : StabilizerChain( combined, n + m, base ).stabilizerGenerators( base.size() ) ) {
+		std::vector<int> g( n );
+		for( int x = 0; x < n; ++x )
+			g[x] = sigma( x );
+		generators.emplace_back( std::move( g ) );
+	}
+	return Group( new Subgroup( group(), generators ) );
 }
 
 template<typename A, typename value_type, typename domain_type>
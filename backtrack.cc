@@ -0,0 +1,270 @@
+#include <vector>
+
+#include "backtrack.h"
+#include "unionfind.h"
+
+int OrderedPartition::cell( int x ) const {
+	return _cell[x];
+}
+
+size_t OrderedPartition::cells() const {
+	return _size.size();
+}
+
+void OrderedPartition::individualize( int x ) {
+	split( [x]( int y ) { return y == x; } );
+}
+
+bool OrderedPartition::matches( const OrderedPartition& other ) const {
+	return _size == other._size;
+}
+
+OrderedPartition::OrderedPartition( int n ) : _cell( n, 0 ), _size( 1, n ) {
+}
+
+// ----------------------------------------------------------------
+
+namespace {
+	// returns for every point the representative of its orbit under the group generated by S
+	std::vector<int> orbitRepresentatives( const std::vector<Permutation>& S, int n ) {
+		UnionFind orbits( n );
+		for( const Permutation& sigma : S )
+			for( int x = 0; x < n; ++x )
+				orbits.cup( x, sigma( x ) );
+		std::vector<int> R( n );
+		for( int x = 0; x < n; ++x )
+			R[x] = orbits.find( x );
+		return R;
+	}
+}
+
+int Orbitals::operator()( int x, int y ) const {
+	return _orbital[ x * n + y ];
+}
+
+bool Orbitals::empty() const {
+	return _orbital.empty();
+}
+
+bool Orbitals::refinesOrbits() const {
+	return _refines;
+}
+
+Orbitals::Orbitals( const std::vector<Permutation>& S, int n ) : n( n ), _refines( false ) {
+	if( n > max_degree )
+		return;
+	UnionFind pairs( n * n );
+	for( const Permutation& sigma : S )
+		for( int x = 0; x < n; ++x )
+			for( int y = 0; y < n; ++y )
+				pairs.cup( x * n + y, sigma( x ) * n + sigma( y ) );
+	_orbital.resize( n * n );
+	size_t count = 0;
+	for( int p = 0; p < n * n; ++p ) {
+		_orbital[p] = pairs.find( p );
+		if( _orbital[p] == p )
+			++count;
+	}
+	// with r orbits, m of them longer than one point, the product of two orbits is at least one orbital
+	// and the product of a longer orbit with itself at least two, the diagonal and the rest
+	std::vector<int> R = orbitRepresentatives( S, n );
+	std::vector<int> length( n, 0 );
+	for( int x = 0; x < n; ++x )
+		++length[ R[x] ];
+	size_t r = 0, m = 0;
+	for( int x = 0; x < n; ++x ) {
+		if( length[x] > 0 )
+			++r;
+		if( length[x] > 1 )
+			++m;
+	}
+	_refines = count != r * r + m;
+}
+
+// ----------------------------------------------------------------
+
+std::vector<int> SearchProperty::basePrefix() const {
+	return {};
+}
+
+void SearchProperty::start( const std::vector<int>& ) {
+}
+
+void SearchProperty::initialise( OrderedPartition&, OrderedPartition& ) const {
+}
+
+void SearchProperty::refine( OrderedPartition&, const std::vector<int>&, bool ) const {
+}
+
+bool SearchProperty::admissible( const std::vector<int>& ) const {
+	return true;
+}
+
+SearchProperty::~SearchProperty() {
+}
+
+std::vector<int> SetStabilizerProperty::basePrefix() const {
+	return _points;
+}
+
+void SetStabilizerProperty::initialise( OrderedPartition& left, OrderedPartition& right ) const {
+	auto member = [this]( int x ) -> bool { return _member[x]; };
+	left.split( member );
+	right.split( member );
+}
+
+bool SetStabilizerProperty::operator()( const Permutation& sigma ) const {
+	for( int x : _points )
+		if( not _member[ sigma( x ) ] )
+			return false;
+	return true;
+}
+
+SetStabilizerProperty::SetStabilizerProperty( int n, const std::vector<int>& points ) : _points( points ), _member( n, false ) {
+	for( int x : points )
+		_member[x] = true;
+}
+
+void CosetMembershipProperty::start( const std::vector<int>& base ) {
+	_chain = _H->chainWithBase( base, true );
+}
+
+void CosetMembershipProperty::refine( OrderedPartition& P, const std::vector<int>&, bool right ) const {
+	if( _orbitals.empty() )
+		return;
+	if( right )
+		P.makeEquitable( [this]( int x, int y ) { return _orbitals( _inverse( x ), _inverse( y ) ); } );
+	else
+		P.makeEquitable( _orbitals );
+}
+
+bool CosetMembershipProperty::admissible( const std::vector<int>& images ) const {
+	// sigma h maps the base points to images exactly when h maps them to sigma^-1( images )
+	_preimages.resize( images.size() );
+	for( size_t i = 0; i < images.size(); ++i )
+		_preimages[i] = _inverse( images[i] );
+	return _chain->hasBaseImage( _preimages );
+}
+
+bool CosetMembershipProperty::operator()( const Permutation& sigma ) const {
+	return _H->contains( _inverse * sigma );
+}
+
+CosetMembershipProperty::CosetMembershipProperty( Group H ) : CosetMembershipProperty( H, H->one() ) {
+}
+
+CosetMembershipProperty::CosetMembershipProperty( Group H, const Permutation& sigma ) : _H( H ), _inverse( sigma.inverse() ), _orbitals( H->generators(), H->degree() ) {
+}
+
+// ----------------------------------------------------------------
+
+void BacktrackSearch::refine( OrderedPartition& P, const std::vector<int>& fixed, const Permutation& g, bool right ) const {
+	// an element mapping the base points to their images maps the orbits of the stabiliser of the
+	// base points onto the orbits of the stabiliser of the images, and the orbitals of G onto themselves
+	const std::vector<int>& O = orbits[ fixed.size() ];
+	if( right ) {
+		Permutation inverse = g.inverse();
+		P.splitBy( [&]( int x ) { return O[ inverse( x ) ]; } );
+	} else
+		P.splitBy( [&O]( int x ) { return O[x]; } );
+	if( orbitals.refinesOrbits() )
+		P.makeEquitable( orbitals );
+	property.refine( P, fixed, right );
+}
+
+bool BacktrackSearch::extend( size_t j, const Permutation& u, const OrderedPartition& right, int delta, Permutation& result ) {
+	int gamma = u( delta );
+	if( right.cell( gamma ) != left[j].cell( base[j] ) )
+		return false;
+	images.resize( j + 1 );
+	images[j] = gamma;
+	if( not property.admissible( images ) )
+		return false;
+	Permutation g = u * chain->transversal( j, delta );
+	OrderedPartition refined( right );
+	refined.individualize( gamma );
+	refine( refined, images, g, true );
+	if( not refined.matches( left[j + 1] ) )
+		return false;
+	if( j + 1 == base.size() ) {
+		if( not property( g ) )
+			return false;
+		result = std::move( g );
+		return true;
+	}
+	for( int epsilon : chain->basicOrbit( j + 1 ) )
+		if( extend( j + 1, g, refined, epsilon, result ) )
+			return true;
+	return false;
+}
+
+std::vector<Permutation> BacktrackSearch::subgroup() {
+	std::vector<Permutation> found;
+	Permutation one( n );
+	Permutation h( 0 );
+	for( size_t i = base.size(); i-- > 0; ) {
+		// the elements found so far fix b_0,...,b_{i-1} and generate a subgroup of the result
+		// an image of b_i in the same orbit under them as b_i, or as an image without solution, is skipped
+		UnionFind orbits( n );
+		for( const Permutation& sigma : found )
+			for( int x = 0; x < n; ++x )
+				orbits.cup( x, sigma( x ) );
+		std::vector<int> failed;
+		for( int gamma : chain->basicOrbit( i ) ) {
+			int r = orbits.find( gamma );
+			if( r == orbits.find( base[i] ) )
+				continue;
+			bool skip = false;
+			for( int y : failed )
+				if( orbits.find( y ) == r )
+					skip = true;
+			if( skip )
+				continue;
+			images.assign( base.begin(), base.begin() + i );
+			if( extend( i, one, left[i], gamma, h ) ) {
+				for( int x = 0; x < n; ++x )
+					orbits.cup( x, h( x ) );
+				found.push_back( std::move( h ) );
+			} else
+				failed.push_back( gamma );
+		}
+	}
+	return found;
+}
+
+bool BacktrackSearch::element( Permutation& result ) {
+	Permutation one( n );
+	if( base.empty() ) {
+		if( not property( one ) )
+			return false;
+		result = one;
+		return true;
+	}
+	OrderedPartition right( n );
+	OrderedPartition unused( n );
+	property.initialise( unused, right );
+	refine( right, {}, one, true );
+	if( not right.matches( left[0] ) )
+		return false;
+	images.clear();
+	for( int delta : chain->basicOrbit( 0 ) )
+		if( extend( 0, one, right, delta, result ) )
+			return true;
+	return false;
+}
+
+BacktrackSearch::BacktrackSearch( Group G, SearchProperty& P ) : n( G->degree() ), property( P ), chain( G->chainWithBase( P.basePrefix(), false ) ), base( chain->base() ), orbitals( G->generators(), n ) {
+	property.start( base );
+	for( size_t j = 0; j <= base.size(); ++j )
+		orbits.push_back( orbitRepresentatives( chain->stabilizerGenerators( j ), n ) );
+	Permutation one( n );
+	OrderedPartition unused( n );
+	left.emplace_back( n );
+	property.initialise( left[0], unused );
+	refine( left[0], {}, one, false );
+	for( size_t j = 0; j < base.size(); ++j ) {
+		left.push_back( left[j] );
+		left[j + 1].individualize( base[j] );
+		refine( left[j + 1], std::vector<int>( base.begin(), base.begin() + j + 1 ), one, false );
+	}
+}
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include "permutation.h"
+#include "stabilizer_chain.h"
+#include "group.h"
+
+// ordered partition of {0,...,n-1}
+class OrderedPartition {
+	std::vector<int> _cell; // index of the cell of every point
+	std::vector<int> _size; // sizes of the cells, in order
+public:
+	// returns the index of the cell containing x
+	int cell( int x ) const;
+
+	// returns the number of cells
+	size_t cells() const;
+
+	// splits the points x for which f( x ) holds off their cells
+	// the new cells are appended in the order of the cells they were split from
+	template<typename F> void split( const F& f );
+
+	// splits every cell by the values of key( x ), the points with the smallest value keep the cell
+	// the new cells are appended in the order of the cells they were split from, and then of the values
+	template<typename K> void splitBy( const K& key );
+
+	// makes x a cell of its own
+	void individualize( int x );
+
+	// refines the partition until it is equitable for the graphs of the labels of ordered pairs:
+	// points of one cell have, for every cell C and label l, equally many y in C with label( x, y ) == l
+	template<typename L> void makeEquitable( const L& label );
+
+	// checks whether the cells have the same sizes in the same order
+	bool matches( const OrderedPartition& other ) const;
+
+	// constructs the partition with a single cell
+	OrderedPartition( int n );
+};
+
+// orbits of a group on ordered pairs of points
+// every element of the group maps the graph of an orbital onto itself, so partitions
+// made equitable for them can be compared across the elements of the group
+class Orbitals {
+	int n;
+	std::vector<int> _orbital; // representative of the orbital of ( x, y ) at x * n + y
+	bool _refines;
+public:
+	// orbitals are only computed up to this degree, there are n^2 pairs
+	static const int max_degree = 256;
+
+	// returns the orbital of ( x, y ), which must be computed
+	int operator()( int x, int y ) const;
+
+	// checks whether the orbitals were computed
+	bool empty() const;
+
+	// checks whether some orbital does not consist of all pairs, or all pairs of distinct points, of two orbits
+	// otherwise a partition refined by the orbits is already equitable for the orbitals
+	bool refinesOrbits() const;
+
+	// computes the orbitals of the group generated by S on n points, unless n exceeds max_degree
+	Orbitals( const std::vector<Permutation>& S, int n );
+};
+
+// property of permutations searched for by BacktrackSearch
+// *************************************************************
+// The search assigns images to the base points one at a time.
+// Left partitions are refined with the base points and right
+// partitions with their images, in the same way: by the orbits
+// of the pointwise stabiliser of the base points, which the
+// element assigned so far maps onto the right side, made
+// equitable for the orbital graphs of the group, and then by
+// the property. An assignment is pruned as soon as the two no
+// longer match, or when the property rules it out by admissible.
+// *************************************************************
+class SearchProperty {
+public:
+	// returns points to put first in the base
+	virtual std::vector<int> basePrefix() const;
+
+	// called with the base of the search before it starts
+	virtual void start( const std::vector<int>& base );
+
+	// refines the initial partitions: left by a structure fixed by the sought elements, right by its image
+	virtual void initialise( OrderedPartition& left, OrderedPartition& right ) const;
+
+	// refines a partition after the points fixed have been individualized
+	// these are base points for a left partition and their images for a right one
+	virtual void refine( OrderedPartition& P, const std::vector<int>& fixed, bool right ) const;
+
+	// checks whether an element mapping the first base points to images can have the property
+	// answering true where it cannot only makes the search slower
+	virtual bool admissible( const std::vector<int>& images ) const;
+
+	// checks whether sigma has the property
+	virtual bool operator()( const Permutation& sigma ) const = 0;
+
+	virtual ~SearchProperty();
+};
+
+// permutations fixing a set of points setwise
+class SetStabilizerProperty : public SearchProperty {
+	std::vector<int> _points;
+	std::vector<char> _member;
+public:
+	virtual std::vector<int> basePrefix() const;
+	virtual void initialise( OrderedPartition& left, OrderedPartition& right ) const;
+	virtual bool operator()( const Permutation& sigma ) const;
+
+	// constructs the property for a set of points of {0,...,n-1}
+	SetStabilizerProperty( int n, const std::vector<int>& points );
+};
+
+// elements of the left coset sigma H, or of H when sigma is omitted
+// partial base images are checked against a stabilizer chain of H with the base of the search
+// partitions are made equitable for the orbitals of H on the left and their images under sigma on the right
+class CosetMembershipProperty : public SearchProperty {
+	Group _H;
+	Permutation _inverse; // sigma^-1
+	Orbitals _orbitals;
+	std::shared_ptr<const StabilizerChain> _chain;
+	mutable std::vector<int> _preimages;
+public:
+	virtual void start( const std::vector<int>& base );
+	virtual void refine( OrderedPartition& P, const std::vector<int>& fixed, bool right ) const;
+	virtual bool admissible( const std::vector<int>& images ) const;
+	virtual bool operator()( const Permutation& sigma ) const;
+
+	CosetMembershipProperty( Group H );
+	CosetMembershipProperty( Group H, const Permutation& sigma );
+};
+
+// backtrack search through a group for elements with a property
+// *************************************************************
+// Every element of G is u_0 * u_1 * ... * u_{k-1} for unique
+// transversal elements u_i of a stabilizer chain, and maps the
+// base point b_i to (u_0 * ... * u_{i-1})( u_i( b_i ) ). The
+// search walks these products depth first and prunes a branch
+// as soon as the images of the base points assigned so far are
+// ruled out by the property.
+// A subgroup is searched from the deepest level up, as in Sims'
+// method: at level i only the elements fixing b_0,...,b_{i-1}
+// are considered, one is enough for every image of b_i, and an
+// image in the orbit of b_i, or of an image without solution,
+// under the elements found so far is skipped.
+// *************************************************************
+class BacktrackSearch {
+	int n;
+	SearchProperty& property;
+	std::shared_ptr<const StabilizerChain> chain;
+	std::vector<int> base;
+	Orbitals orbitals;
+	std::vector<std::vector<int>> orbits; // orbits[j][x] represents the orbit of x under the stabiliser of b_0,...,b_{j-1}
+	std::vector<OrderedPartition> left; // left[j] has b_0,...,b_{j-1} individualized
+	std::vector<int> images;
+
+	// refines P after the first points of the base, or their images under g, have been individualized
+	void refine( OrderedPartition& P, const std::vector<int>& fixed, const Permutation& g, bool right ) const;
+
+	// assigns the image u( delta ) to base point j, with delta in the basic orbit of level j, and searches on
+	// returns true with the element in result when one has the property
+	bool extend( size_t j, const Permutation& u, const OrderedPartition& right, int delta, Permutation& result );
+public:
+	// returns generators of the subgroup of elements with the property, which must describe a subgroup
+	// the list is empty when that subgroup is trivial, as for SubgroupGenerator
+	std::vector<Permutation> subgroup();
+
+	// finds an element with the property, returns false when there is none
+	bool element( Permutation& result );
+
+	// prepares the search through G, with a base starting with the points of property.basePrefix()
+	// the stabilizer chain is taken from G, which only rearranges the base of a chain it already has
+	BacktrackSearch( Group G, SearchProperty& property );
+};
+
+// ----------------------------------------------------------------
+
+template<typename F>
+void OrderedPartition::split( const F& f ) {
+	std::vector<int> count( _size.size(), 0 );
+	for( size_t x = 0; x < _cell.size(); ++x )
+		if( f( int( x ) ) )
+			++count[ _cell[x] ];
+	// index of the new cell split from every cell, -1 when it is not split
+	std::vector<int> target( _size.size(), -1 );
+	for( size_t c = 0, cs = _size.size(); c < cs; ++c ) {
+		if( count[c] == 0 or count[c] == _size[c] )
+			continue;
+		target[c] = _size.size();
+		_size.push_back( count[c] );
+		_size[c] -= count[c];
+	}
+	for( size_t x = 0; x < _cell.size(); ++x )
+		if( target[ _cell[x] ] >= 0 and f( int( x ) ) )
+			_cell[x] = target[ _cell[x] ];
+}
+
+template<typename K>
+void OrderedPartition::splitBy( const K& key ) {
+	typedef decltype( key( 0 ) ) value_type;
+	std::vector<value_type> values;
+	values.reserve( _cell.size() );
+	for( size_t x = 0; x < _cell.size(); ++x )
+		values.push_back( key( int( x ) ) );
+	std::vector<std::vector<int>> members( _size.size() );
+	for( size_t x = 0; x < _cell.size(); ++x )
+		members[ _cell[x] ].push_back( x );
+	for( size_t c = 0, cs = members.size(); c < cs; ++c ) {
+		std::vector<int>& M = members[c];
+		std::stable_sort( M.begin(), M.end(), [&values]( int x, int y ) { return values[x] < values[y]; } );
+		int target = c;
+		for( size_t k = 1; k < M.size(); ++k ) {
+			if( values[ M[k - 1] ] < values[ M[k] ] ) {
+				target = _size.size();
+				_size.push_back( 0 );
+			}
+			if( target != int( c ) ) {
+				_cell[ M[k] ] = target;
+				++_size[target];
+				--_size[c];
+			}
+		}
+	}
+}
+
+template<typename L>
+void OrderedPartition::makeEquitable( const L& label ) {
+	// every cell is used once as splitter, and again whenever it lost points
+	std::vector<int> queue( _size.size() );
+	for( size_t c = 0; c < queue.size(); ++c )
+		queue[c] = c;
+	std::vector<char> queued( _size.size(), true );
+	std::vector<int> splitter;
+	for( size_t head = 0; head < queue.size() and _size.size() < _cell.size(); ++head ) {
+		int s = queue[head];
+		queued[s] = false;
+		splitter.clear();
+		for( size_t y = 0; y < _cell.size(); ++y )
+			if( _cell[y] == s )
+				splitter.push_back( y );
+		std::vector<int> sizes( _size );
+		splitBy( [&]( int x ) {
+			std::vector<decltype( label( 0, 0 ) )> labels;
+			labels.reserve( splitter.size() );
+			for( int y : splitter )
+				labels.push_back( label( x, y ) );
+			std::sort( labels.begin(), labels.end() );
+			return labels;
+		} );
+		queued.resize( _size.size(), false );
+		for( size_t c = 0; c < _size.size(); ++c )
+			if( ( c >= sizes.size() or _size[c] != sizes[c] ) and not queued[c] ) {
+				queued[c] = true;
+				queue.push_back( c );
+			}
+	}
+}
@@ -73,7 +73,8 @@ void IsoJoiner::join( Iso I ) {
 		_subgroup = I.coset().subgroup();
 		_supergroup = I.coset().supergroup();
 	}
-	elements.push_back( I.coset().representative() );
+	if( seen.insert( I.coset().representative() ).second )
+		elements.push_back( I.coset().representative() );
 }
 
 IsoJoiner::operator Iso() {
@@ -84,6 +85,13 @@ IsoJoiner::operator Iso() {
 	elements.pop_back();
 	for( Permutation& tau : elements )
 		tau = sigma_inverse * tau;
+	// elements already in the subgroup do not enlarge it
+	std::vector<Permutation> taus( elements.begin(), elements.end() );
+	std::vector<bool> member = _subgroup->containsMask( taus );
+	elements.clear();
+	for( size_t k = 0; k < taus.size(); ++k )
+		if( not member[k] )
+			elements.push_back( std::move( taus[k] ) );
 	_subgroup = _subgroup->join( std::move( elements ) );
 	return Coset( _supergroup, _subgroup, sigma, false );
 }
\ No newline at end of file
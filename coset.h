@@ -59,6 +59,7 @@ class IsoJoiner {
 	Group _supergroup;
 	Group _subgroup;
 	std::deque<Permutation> elements;
+	PermutationSet seen;
 public:
 	void join( Iso I );
 	explicit operator Iso();
@@ -0,0 +1,58 @@
+#include <iostream>
+#include "../permutation.h"
+#include "../group.h"
+#include "../stabilizer_chain.h"
+
+int main() {
+	std::cout << std::boolalpha;
+	std::vector<Permutation> S = { {1,2,3,4,5,6,7,8,9,0}, {1,0,2,3,4,5,6,7,8,9} };
+
+	// changing the base keeps the group
+	StabilizerChain C( S, 10 );
+	natural order = C.exactOrder();
+	C.changeBase( { 7, 3 } );
+	std::cout << ( C.base()[0] == 7 and C.base()[1] == 3 ) << std::endl;
+	std::cout << ( C.exactOrder() == order ) << std::endl;
+	std::cout << ( C.contains( S[0] ) and C.contains( S[1] ) ) << std::endl;
+
+	// the base of an incomplete Monte Carlo chain can be changed, giving a chain at least as large
+	StabilizerChainOptions options;
+	options.randomized = true;
+	options.verify = false;
+	options.sifts = 1;
+	StabilizerChain D( S, 10, {}, options );
+	natural partial = D.exactOrder();
+	D.changeBase( { 5 } );
+	std::cout << ( D.base()[0] == 5 and D.exactOrder() >= partial ) << std::endl;
+
+	std::cout << "------------------------------" << std::endl;
+	// base strategies are applied to cached chains and to rebased groups
+	StabilizerChainOptions strategy;
+	strategy.base_strategy = BaseStrategy::given_order;
+	strategy.base_order = { 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 };
+	Group S10( new SymmetricGroup( 10 ) );
+	Group G( new Subgroup( S10, S ) );
+	std::cout << int( G->order() ) << std::endl;
+	Group H( new Subgroup( S10, S, strategy ) );
+	std::cout << ( H->chainWithBase( {}, true )->base()[0] == 9 ) << std::endl;
+	Group K = G->rebased( strategy );
+	std::cout << ( K->chainWithBase( {}, true )->base()[0] == 9 and K->exactOrder() == G->exactOrder() ) << std::endl;
+	std::cout << ( std::static_pointer_cast<const Subgroup>( K )->supergroup() == S10 ) << std::endl;
+
+	std::cout << "------------------------------" << std::endl;
+	// base changes swap base points, and keep the group and the stabilisers of the new prefix
+	// S_4 wr S_3 on 12 points, of order 24^3 * 6
+	StabilizerChain W( { {1,2,3,0,4,5,6,7,8,9,10,11}, {1,0,2,3,4,5,6,7,8,9,10,11}, {4,5,6,7,8,9,10,11,0,1,2,3}, {4,5,6,7,0,1,2,3,8,9,10,11} }, 12 );
+	natural wreath = W.exactOrder();
+	bool kept = true;
+	for( int x = 0; x < 12; ++x ) {
+		StabilizerChain V( W );
+		V.changeBase( { x, ( x + 5 ) % 12 } );
+		kept = kept and V.base()[0] == x and V.base()[1] == ( x + 5 ) % 12 and V.exactOrder() == wreath;
+		kept = kept and V.basicOrbit( 0 ).size() == 12 and V.basicOrbit( 1 ).size() == 8;
+		kept = kept and V.contains( {4,5,6,7,8,9,10,11,0,1,2,3} ) and not V.contains( {1,2,3,4,5,6,7,8,9,10,11,0} );
+	}
+	std::cout << wreath << " " << kept << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,76 @@
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include "../permutation.h"
+#include "../group.h"
+#include "../action.h"
+#include "../fhl.h"
+
+// runs f( t ) on THREADS threads at once
+template<typename F>
+void together( F f ) {
+	std::vector<std::thread> threads;
+	for( int t = 0; t < THREADS; ++t )
+		threads.emplace_back( f, t );
+	for( auto& thread : threads )
+		thread.join();
+}
+
+// build with 'make tsan' to have ThreadSanitizer check the shared caches used here
+int main() {
+	std::cout << std::boolalpha;
+	std::atomic<int> wrong( 0 );
+
+	// permutations filling their fingerprint and cycle caches from several threads
+	std::vector<Permutation> P = { {1,2,3,4,5,0,7,6}, {2,0,1,4,5,6,7,3}, {1,0,3,2,5,4,7,6} };
+	std::vector<uint64_t> fingerprints;
+	std::vector<int> orders;
+	for( const Permutation& sigma : P ) {
+		Permutation copy( sigma.getArrayNotation() );
+		fingerprints.push_back( copy.fingerprint() );
+		orders.push_back( copy.order() );
+	}
+	together( [&]( int t ) {
+		for( size_t k = 0; k < P.size(); ++k ) {
+			const Permutation& sigma = P[ ( k + t ) % P.size() ];
+			size_t i = ( k + t ) % P.size();
+			Permutation copy( sigma );
+			if( sigma.fingerprint() != fingerprints[i] or sigma.order() != orders[i] or copy.cycleType() != sigma.cycleType() or not ( copy == sigma ) )
+				++wrong;
+		}
+	} );
+	std::cout << ( wrong == 0 ) << std::endl;
+
+	// a subgroup building its stabilizer chain, and an action its orbits and kernel, on first use by any thread
+	Group S6( new SymmetricGroup( 6 ) );
+	Group W( new Subgroup( S6, { {1,2,0,3,4,5}, {1,0,2,3,4,5}, {3,4,5,0,1,2} } ) );
+	auto B = NaturalAction( W ).systemOfImprimitivity();
+	together( [&]( int ) {
+		if( int( W->order() ) != 72 or not W->contains( {4,5,3,1,2,0} ) or W->contains( {1,2,3,4,5,0} ) )
+			++wrong;
+		if( int( B.kernel()->order() ) != 36 or B.orbits().size() != 1 )
+			++wrong;
+	} );
+	std::cout << ( wrong == 0 ) << std::endl;
+
+	// pullbacks evaluating their cells on first use by any thread
+	Permutation pi( {5,3,1,0,2,4} );
+	std::vector<Permutation> originals = W->generators(), pullbacks;
+	for( const Permutation& tau : originals )
+		pullbacks.push_back( pi * tau * pi.inverse() );
+	PullbackStructure pullback( S6, originals, pullbacks );
+	size_t instructions = pullback.words().size();
+	together( [&]( int t ) {
+		Permutation tau( 6 );
+		for( int k = 0; k < 100; ++k ) {
+			tau = tau * originals[ ( k * k + t ) % originals.size() ];
+			if( pullback( tau ) != pi * tau * pi.inverse() )
+				++wrong;
+			if( not pullback.contains( tau ) or pullback.contains( {1,2,3,4,5,0} ) or not pullback.find( tau ).isIdentity() )
+				++wrong;
+		}
+	} );
+	std::cout << ( wrong == 0 and pullback.words().size() == instructions ) << std::endl;
+
+	return 0;
+}
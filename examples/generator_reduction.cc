@@ -0,0 +1,40 @@
+#include <iostream>
+#include <stdexcept>
+#include "../permutation.h"
+#include "../stabilizer_chain.h"
+
+// checks that both reductions of S generate a group of the same order
+void check( const std::vector<Permutation>& S, int n ) {
+	natural order = StabilizerChain( S, n ).exactOrder();
+	std::vector<Permutation> J = jerrumFilter( S, n );
+	std::vector<Permutation> R = randomSubproducts( S, n, order );
+	std::cout << ( StabilizerChain( J, n ).exactOrder() == order ) << " " << ( int( J.size() ) < std::max( n, 1 ) ) << " ";
+	std::cout << ( StabilizerChain( R, n ).exactOrder() == order ) << std::endl;
+}
+
+int main() {
+	std::cout << std::boolalpha;
+
+	// S_8 from many redundant generators
+	std::vector<Permutation> S8 = { {1,2,3,4,5,6,7,0}, {1,0,2,3,4,5,6,7} };
+	for( int k = 0; k < 20; ++k )
+		S8.push_back( S8[k] * S8[k + 1] );
+	check( S8, 8 );
+
+	// S_3 wr S_3 on 9 points
+	check( { {1,2,0,3,4,5,6,7,8}, {1,0,2,3,4,5,6,7,8}, {3,4,5,6,7,8,0,1,2}, {3,4,5,0,1,2,6,7,8}, {0,1,2,4,5,3,6,7,8} }, 9 );
+
+	// the trivial group
+	check( { Permutation( 5 ) }, 5 );
+
+	std::cout << "------------------------------" << std::endl;
+	// a wrong order is reported instead of searched for forever
+	try {
+		randomSubproducts( S8, 8, natural( 2 ) * StabilizerChain( S8, 8 ).exactOrder() );
+		std::cout << false << std::endl;
+	} catch( const std::invalid_argument& ) {
+		std::cout << true << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,38 @@
+#include <iostream>
+#include "../permutation.h"
+#include "../group.h"
+
+int main() {
+	std::cout << std::boolalpha;
+	Group S12( new SymmetricGroup( 12 ) );
+	Group A12( new Subgroup( S12, { {1,2,0,3,4,5,6,7,8,9,10,11}, {0,2,3,4,5,6,7,8,9,10,11,1} } ) );
+	// S_6 wr S_2, transitive with blocks {0,...,5} and {6,...,11}
+	Group W( new Subgroup( S12, { {1,2,3,4,5,0,6,7,8,9,10,11}, {1,0,2,3,4,5,6,7,8,9,10,11}, {6,7,8,9,10,11,0,1,2,3,4,5} } ) );
+	// the cyclic group generated by a 12-cycle
+	Group C( new Subgroup( S12, { {1,2,3,4,5,6,7,8,9,10,11,0} } ) );
+
+	// the Monte Carlo test
+	std::cout << A12->isGiant() << std::endl;
+	std::cout << Group( new Subgroup( S12, S12->generators() ) )->isGiant() << std::endl;
+	std::cout << W->isGiant() << std::endl;
+	std::cout << C->isGiant() << std::endl;
+
+	std::cout << "------------------------------" << std::endl;
+	// the deterministic test
+	std::cout << A12->isGiant( 0 ) << std::endl;
+	std::cout << W->isGiant( 0 ) << std::endl;
+
+	std::cout << "------------------------------" << std::endl;
+	// with a large error, repeated calls on a giant give both answers, but a non-giant is never reported
+	int found = 0, false_positives = 0;
+	for( int k = 0; k < 200; ++k ) {
+		Group G( new Subgroup( S12, A12->generators() ) );
+		found += G->isGiant( 0.5 );
+		Group H( new Subgroup( S12, W->generators() ) );
+		false_positives += H->isGiant( 0.5 );
+	}
+	std::cout << ( found > 0 and found < 200 ) << std::endl;
+	std::cout << ( false_positives == 0 ) << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,37 @@
+#include <iostream>
+#include "../permutation.h"
+#include "../group.h"
+#include "../group_cache.h"
+
+int main() {
+	std::cout << std::boolalpha;
+	GroupCache& cache = GroupCache::global();
+	cache.clear();
+	Group S6( new SymmetricGroup( 6 ) );
+	Permutation sigma( {1,2,3,4,5,0} );
+	Permutation mu( {1,0,2,3,4,5} );
+
+	// keys ignore the order and repetitions of the generators, but not the generators themselves
+	std::cout << ( GroupCache::Key( { sigma, mu }, 6 ) == GroupCache::Key( { mu, sigma, mu, Permutation( 6 ) }, 6 ) ) << std::endl;
+	std::cout << ( GroupCache::Key( { sigma, mu }, 6 ) == GroupCache::Key( { sigma, sigma * mu }, 6 ) ) << std::endl;
+
+	// an entry that does not contain the generators is not used
+	cache.storeChain( GroupCache::Key( { sigma, mu }, 6 ), std::make_shared<const StabilizerChain>( std::vector<Permutation>{ sigma }, 6 ) );
+	Group G( new Subgroup( S6, { sigma, mu } ) );
+	std::cout << int( G->order() ) << std::endl;
+	std::cout << ( int( cache.chain( GroupCache::Key( { sigma, mu }, 6 ) )->order() ) == 720 ) << std::endl;
+
+	std::cout << "------------------------------" << std::endl;
+	// chains handed to a subgroup are shared unless they are Monte Carlo chains
+	StabilizerChainOptions options;
+	options.randomized = true;
+	options.verify = false;
+	auto C = std::make_shared<const StabilizerChain>( std::vector<Permutation>{ { 1,2,0,3,4,5 }, { 0,1,2,4,5,3 } }, 6, std::vector<int>(), options );
+	Group H( new Subgroup( S6, C, options ) );
+	std::cout << int( H->order() ) << std::endl;
+	std::cout << ( cache.chain( GroupCache::Key( H->generators(), 6 ) ) == nullptr ) << std::endl;
+	Group K( new Subgroup( S6, std::make_shared<const StabilizerChain>( std::vector<Permutation>{ { 1,0,2,3,4,5 } }, 6 ) ) );
+	std::cout << ( cache.chain( GroupCache::Key( K->generators(), 6 ) ) != nullptr ) << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,98 @@
+#include <iostream>
+#include <cstdio>
+#include "../permutation.h"
+#include "../group.h"
+#include "../group_cache.h"
+#include "../stabilizer_chain.h"
+#include "../fhl.h"
+#include "../coset.h"
+
+int main() {
+	std::cout << std::boolalpha;
+	// S_3 wr S_3 on 9 points, of order 6^3 * 6 = 1296
+	int n = 9;
+	std::vector<Permutation> S = { {1,2,0,3,4,5,6,7,8}, {1,0,2,3,4,5,6,7,8}, {3,4,5,6,7,8,0,1,2}, {3,4,5,0,1,2,6,7,8} };
+	std::vector<Permutation> P = { {4,5,3,1,2,0,6,7,8}, {1,2,3,4,5,6,7,8,0}, {0,1,2,3,4,5,6,8,7}, {0,1,2,3,4,6,5,7,8} };
+	std::vector<bool> members = { true, false, true, false };
+
+	// the stabilizer chain and the FHL structure encode the same group
+	StabilizerChain C( S, n );
+	FHL<Permutation> F( S, n );
+	std::cout << int( C.order() ) << " " << int( F.order() ) << std::endl;
+	std::cout << ( C.exactOrder() == F.exactOrder() and C.log2Order() > 10.33 and C.log2Order() < 10.34 ) << std::endl;
+
+	// batch membership agrees with single tests, also for batches sifted concurrently
+	std::cout << ( C.containsMask( P ) == members and not C.containsAll( P ) and C.containsAll( S ) ) << std::endl;
+	std::vector<Permutation> batch;
+	std::vector<bool> expected;
+	for( size_t k = 0; k < 2 * StabilizerChain::batch_size; ++k ) {
+		batch.push_back( P[ k % P.size() ] * S[ k % S.size() ] );
+		expected.push_back( members[ k % P.size() ] );
+	}
+	std::cout << ( C.containsMask( batch ) == expected ) << std::endl;
+
+	// the order can be bounded without building the whole chain
+	StabilizerChainOptions options;
+	options.bound = 100;
+	StabilizerChain B( S, n, {}, options );
+	std::cout << ( B.orderAtLeast( 100 ) and C.orderAtLeast( 1296 ) and not C.orderAtLeast( 1297 ) ) << std::endl;
+
+	std::cout << "------------------------------" << std::endl;
+	// parallel builds give the same structures as serial ones
+	std::vector<Permutation> T = { {1,2,3,4,5,6,7,8,9,10,0}, {1,0,2,3,4,5,6,7,8,9,10}, {0,2,1,4,3,6,5,8,7,10,9} };
+	StabilizerChainOptions parallel;
+	parallel.parallel = true;
+	StabilizerChain serial_chain( T, 11 ), parallel_chain( T, 11, {}, parallel );
+	std::cout << ( serial_chain.base() == parallel_chain.base() and serial_chain.listGenerators() == parallel_chain.listGenerators() ) << std::endl;
+	FHL<Permutation> serial_fhl, parallel_fhl;
+	serial_fhl.create( S, n );
+	parallel_fhl.create( S, n, true );
+	std::cout << ( serial_fhl.listGenerators() == parallel_fhl.listGenerators() ) << std::endl;
+
+	std::cout << "------------------------------" << std::endl;
+	// the least base images under a subgroup tell its left cosets apart
+	Group S7( new SymmetricGroup( 7 ) );
+	Group N( new Subgroup( S7, { {1,0,2,3,4,5,6}, {0,1,3,4,5,6,2} } ) );
+	auto image = [&N]( const Permutation& sigma ) { return N->chainWithBase( {}, false )->minimalCosetImage( sigma ); };
+	Permutation sigma( {3,5,0,6,1,2,4} ), h( {1,0,4,2,3,6,5} ), tau( {2,1,0,3,4,5,6} );
+	std::cout << ( image( sigma ) == image( sigma * h ) and image( sigma ) != image( sigma * tau ) ) << std::endl;
+
+	// cosets of a normal subgroup enumerated with their representatives bucketed by that image
+	// S_2 wr S_6 over its base group S_2^6
+	Group S12( new SymmetricGroup( 12 ) );
+	Group wreath( new Subgroup( S12, { {1,0,2,3,4,5,6,7,8,9,10,11}, {2,3,4,5,6,7,8,9,10,11,0,1}, {2,3,0,1,4,5,6,7,8,9,10,11} } ) );
+	Group base( new Subgroup( S12, { {1,0,2,3,4,5,6,7,8,9,10,11}, {0,1,3,2,4,5,6,7,8,9,10,11}, {0,1,2,3,5,4,6,7,8,9,10,11}, {0,1,2,3,4,5,7,6,8,9,10,11}, {0,1,2,3,4,5,6,7,9,8,10,11}, {0,1,2,3,4,5,6,7,8,9,11,10} } ) );
+	std::vector<Coset> cosets = wreath->allCosets( base );
+	bool distinct = true;
+	for( size_t i = 0; i < cosets.size(); ++i )
+		for( size_t j = 0; j < i; ++j )
+			distinct = distinct and not base->contains( cosets[j].representative().inverse() * cosets[i].representative() );
+	std::cout << cosets.size() << " " << distinct << std::endl;
+
+	std::cout << "------------------------------" << std::endl;
+	// structures written to a file read back to the same group
+	std::string path = "/tmp/membership_structures.bin";
+	C.save( path );
+	StabilizerChain D;
+	D.load( path );
+	std::cout << ( D.base() == C.base() and D.exactOrder() == C.exactOrder() and D.containsMask( P ) == members ) << std::endl;
+	// a loaded chain can be extended
+	D.extend( { P[3] } );
+	std::cout << ( D.contains( P[3] ) and D.exactOrder() > C.exactOrder() and D.contains( S[0] ) ) << std::endl;
+
+	F.save( path );
+	FHL<Permutation> G;
+	G.load( path );
+	std::cout << ( G.exactOrder() == F.exactOrder() and G.contains( P[0] ) and not G.contains( P[1] ) ) << std::endl;
+
+	GroupCache::global().clear();
+	Group S9( new SymmetricGroup( n ) );
+	std::shared_ptr<const Subgroup> H( new Subgroup( S9, S ) );
+	H->save( path );
+	GroupCache::global().clear();
+	Group K = Subgroup::load( path, S9 );
+	std::cout << ( K->generators() == H->generators() and int( K->order() ) == 1296 and K->containsMask( P ) == members ) << std::endl;
+	std::remove( path.c_str() );
+
+	return 0;
+}
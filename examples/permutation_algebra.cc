@@ -0,0 +1,130 @@
+#include <iostream>
+#include <stdexcept>
+#include "../permutation.h"
+#include "../fhl.h"
+
+// returns a permutation of degree n with a cycle on the points offset,...,offset+length-1 for each length
+Permutation cycles( int n, const std::vector<int>& lengths ) {
+	std::vector<int> images( n );
+	for( int i = 0; i < n; ++i )
+		images[i] = i;
+	int offset = 0;
+	for( int length : lengths ) {
+		for( int i = 0; i < length; ++i )
+			images[ offset + i ] = offset + ( i + 1 ) % length;
+		offset += length;
+	}
+	return Permutation( std::move( images ) );
+}
+
+// reference product ( sigma * tau )( x ) = sigma( tau( x ) ), computed point by point
+Permutation product( const Permutation& sigma, const Permutation& tau ) {
+	std::vector<int> images( sigma.degree() );
+	for( int i = 0; i < sigma.degree(); ++i )
+		images[i] = sigma( tau( i ) );
+	return Permutation( std::move( images ) );
+}
+
+// checks the arithmetic on permutations of degree n
+void check( int n ) {
+	Permutation sigma = cycles( n, { n } );
+	Permutation tau = cycles( n, { 2, 3, n - 5 } );
+	Permutation expected = product( sigma, tau );
+
+	// products written over one of their operands
+	Permutation a( sigma ), b( tau ), dst( 1 );
+	Permutation::composeInto( a, a, b );
+	Permutation::composeInto( b, sigma, b );
+	Permutation::composeInto( dst, sigma, tau );
+	std::cout << ( a == expected and b == expected and dst == expected and sigma * tau == expected ) << " ";
+
+	// in-place multiplication from the left and inversion
+	Permutation c( tau );
+	c.leftMultiplyInPlace( sigma );
+	Permutation inverse( 1 );
+	c.invertInto( inverse );
+	std::cout << ( c == expected and ( inverse * c ).isIdentity() and inverse == expected.inverse() ) << " ";
+
+	// powers, negative ones included
+	Permutation power( n );
+	for( int k = 0; k < 7; ++k )
+		power *= expected;
+	std::cout << ( ( expected ^ 7 ) == power and ( expected ^ -7 ) == power.inverse() and ( expected ^ 0 ).isIdentity() ) << " ";
+
+	// lists composed by one permutation
+	std::vector<Permutation> S = { sigma, tau, expected };
+	std::vector<Permutation> right = composeAll( S, tau ), left = composeAll( sigma, S );
+	bool all = true;
+	for( size_t k = 0; k < S.size(); ++k )
+		all = all and right[k] == product( S[k], tau ) and left[k] == product( sigma, S[k] );
+	std::cout << all << std::endl;
+}
+
+int main() {
+	std::cout << std::boolalpha;
+
+	// inline permutations, and images of one, two and four bytes
+	for( int n : { 10, 48, 100, 300, 70000 } )
+		check( n );
+
+	// restriction to an invariant set
+	Permutation pi( {1,0,3,4,2,5} );
+	Permutation restricted( 1 );
+	pi.projectInto( restricted, { 2, 3, 4 } );
+	std::cout << ( restricted == Permutation( {1,2,0} ) and pi.project( { 2, 3, 4 } ) == restricted ) << std::endl;
+
+	std::cout << "------------------------------" << std::endl;
+	// orders beyond an int are reported by order() and computed by exactOrder()
+	Permutation rho = cycles( 129, { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29 } );
+	try {
+		rho.order();
+		std::cout << false << std::endl;
+	} catch( const std::overflow_error& ) {
+		std::cout << true << std::endl;
+	}
+	std::cout << ( rho.exactOrder() == natural( 6469693230ull ) ) << std::endl;
+	std::cout << ( rho.log2Order() > 32.5 and rho.log2Order() < 32.6 ) << std::endl;
+	std::cout << ( cycles( 12, { 3, 4 } ).order() == 12 ) << std::endl;
+
+	// cycle types and conjugacy
+	Permutation mu = cycles( 12, { 3, 4 } ), nu = cycles( 12, { 4, 3 } );
+	std::cout << ( mu.cycleType() == std::vector<int>{ 4, 3, 1, 1, 1, 1, 1 } and mu.isConjugate( nu ) and not mu.isConjugate( cycles( 12, { 7 } ) ) ) << std::endl;
+
+	std::cout << "------------------------------" << std::endl;
+	// equal permutations have equal fingerprints and are found in hashed containers
+	PermutationSet set;
+	for( int k = 0; k < 10; ++k )
+		set.insert( mu ^ k );
+	std::cout << ( set.size() == 10 ) << " " << ( set.count( nu * nu.inverse() ) == 1 ) << " " << ( set.count( nu ) == 0 ) << std::endl;
+	PermutationInterner interner;
+	auto first = interner.intern( mu * nu );
+	auto second = interner.intern( product( mu, nu ) );
+	std::cout << ( first == second and interner.size() == 1 and interner.contains( mu * nu ) ) << std::endl;
+	second.reset();
+	first.reset();
+	interner.collect();
+	std::cout << ( interner.size() == 0 ) << std::endl;
+
+	std::cout << "------------------------------" << std::endl;
+	// permutations of degree at most 48 never take buffers from the allocator
+	size_t allocations = ScratchPool::allocations();
+	Permutation small = cycles( 48, { 48 } );
+	Permutation x( small );
+	for( int k = 0; k < 1000; ++k )
+		x = ( x * small ).inverse() ^ 3;
+	std::cout << ( ScratchPool::allocations() == allocations ) << std::endl;
+
+	// once the pool is warm, building the same FHL again and querying it takes no new buffers
+	int n = 60;
+	std::vector<Permutation> S = { cycles( n, { n } ), cycles( n, { n } ) ^ 5 };
+	auto build = [&]() -> bool {
+		FHL<Permutation> F( S, n );
+		return F.contains( S[0] * S[1] ) and not F.contains( cycles( n, { 2 } ) * S[0] );
+	};
+	bool correct = build();
+	allocations = ScratchPool::allocations();
+	correct = correct and build();
+	std::cout << correct << " " << ( ScratchPool::allocations() == allocations ) << std::endl;
+
+	return 0;
+}
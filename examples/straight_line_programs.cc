@@ -0,0 +1,64 @@
+#include <iostream>
+#include <random>
+#include "../permutation.h"
+#include "../group.h"
+#include "../fhl.h"
+
+int main() {
+	std::cout << std::boolalpha;
+
+	// a long word evaluated from a straight-line program keeps only a few values at once
+	StraightLineProgram program;
+	Permutation sigma( {1,2,3,4,5,6,7,0} );
+	Permutation mu( {1,0,2,3,4,5,6,7} );
+	int a = program.generator( 0 ), b = program.generator( 1 );
+	int w = a;
+	Permutation expected( sigma );
+	for( int k = 1; k < 10000; ++k ) {
+		w = program.product( w, k % 3 ? a : b );
+		expected = expected * ( k % 3 ? sigma : mu );
+	}
+	size_t width = 0;
+	std::vector<Permutation> values = program.evaluate( { w, program.inverse( w ) }, { sigma, mu }, 8, &width );
+	std::cout << ( values[0] == expected ) << std::endl;
+	std::cout << ( values[1] == expected.inverse() ) << std::endl;
+	std::cout << ( width <= 4 ) << std::endl;
+
+	// compacting keeps the words and drops the rest
+	std::vector<int> words( 1, w );
+	program.product( w, w );
+	program.compact( words );
+	std::cout << ( program.size() == 10001 ) << std::endl;
+	std::cout << ( program.evaluate( words, { sigma, mu }, 8 )[0] == expected ) << std::endl;
+
+	std::cout << "------------------------------" << std::endl;
+	// pullbacks along the isomorphism conjugating by pi, from many sifts
+	int n = 12;
+	Permutation pi( {3,7,1,0,11,2,5,4,10,9,6,8} );
+	std::vector<Permutation> originals = { {1,2,3,4,5,6,7,8,9,10,11,0}, {1,0,2,3,4,5,6,7,8,9,10,11} };
+	std::vector<Permutation> pullbacks;
+	for( const Permutation& tau : originals )
+		pullbacks.push_back( pi * tau * pi.inverse() );
+	PullbackStructure P( Group( new SymmetricGroup( n ) ), originals, pullbacks );
+	size_t cells = P.listGenerators().size();
+	size_t size = P.words().size();
+	std::cout << ( size <= originals.size() + cells * ( n + 2 ) ) << std::endl;
+
+	std::mt19937 rng( 1 );
+	std::vector<Permutation> batch;
+	bool correct = true;
+	Permutation tau( n );
+	for( int k = 0; k < 5000; ++k ) {
+		tau = tau * originals[ rng() % 2 ];
+		correct = correct and P( tau ) == pi * tau * pi.inverse();
+		if( k % 10 == 0 )
+			batch.push_back( tau );
+	}
+	std::vector<Permutation> R = P( batch );
+	for( size_t k = 0; k < batch.size(); ++k )
+		correct = correct and R[k] == pi * batch[k] * pi.inverse();
+	std::cout << correct << std::endl;
+	std::cout << ( P.words().size() == size ) << std::endl;
+
+	return 0;
+}
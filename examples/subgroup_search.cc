@@ -0,0 +1,118 @@
+#include <iostream>
+#include <algorithm>
+#include <set>
+#include "../permutation.h"
+#include "../group.h"
+#include "../action.h"
+#include "../backtrack.h"
+#include "../predicates.h"
+
+// checks whether sigma is an even permutation
+bool even( const Permutation& sigma ) {
+	int transpositions = 0;
+	for( int length : sigma.cycleType() )
+		transpositions += length - 1;
+	return transpositions % 2 == 0;
+}
+
+int main() {
+	std::cout << std::boolalpha;
+	Group S6( new SymmetricGroup( 6 ) );
+	Group S7( new SymmetricGroup( 7 ) );
+	// S_3 wr S_2, preserving the blocks {0,1,2} and {3,4,5}
+	Group W( new Subgroup( S6, { {1,2,0,3,4,5}, {1,0,2,3,4,5}, {3,4,5,0,1,2} } ) );
+
+	// set stabilisers by backtrack search, compared with subgroups given by a predicate
+	Group H = S7->setStabilizer( { 0, 1, 2 } );
+	Group K( new Subgroup( S7, []( const Permutation& sigma ) -> bool { return sigma( 0 ) < 3 and sigma( 1 ) < 3 and sigma( 2 ) < 3; } ) );
+	std::cout << int( H->order() ) << " " << ( H->hasSubgroup( K ) and K->hasSubgroup( H ) ) << std::endl;
+	std::cout << int( W->setStabilizer( { 0, 1, 2 } )->order() ) << " " << int( W->setStabilizer( { 0, 3 } )->order() ) << std::endl;
+
+	// intersections by backtrack search
+	Group A6( new Subgroup( S6, even ) );
+	Group C6( new Subgroup( S6, { {1,2,3,4,5,0} } ) );
+	std::cout << int( A6->order() ) << " " << int( W->intersection( A6 )->order() ) << " " << int( W->intersection( C6 )->order() ) << std::endl;
+
+	// elements of a coset found by backtrack search, or their absence
+	Permutation c( {1,2,3,4,5,0} );
+	Group C3( new Subgroup( S6, { c * c } ) );
+	CosetMembershipProperty coset( C3, c );
+	Permutation found( 6 );
+	bool exists = BacktrackSearch( W, coset ).element( found );
+	std::cout << ( exists and W->contains( found ) and C3->contains( c.inverse() * found ) ) << std::endl;
+	CosetMembershipProperty outside( Group( new Subgroup( S6, { Permutation( 6 ) } ) ), c );
+	std::cout << ( not BacktrackSearch( W, outside ).element( found ) ) << std::endl;
+
+	std::cout << "------------------------------" << std::endl;
+	// partitions made equitable for the orbital graphs of a dihedral group split a hexagon by the distance to a vertex
+	Orbitals D( { {1,2,3,4,5,0}, {0,5,4,3,2,1} }, 6 );
+	OrderedPartition hexagon( 6 );
+	hexagon.individualize( 0 );
+	hexagon.makeEquitable( D );
+	std::cout << hexagon.cells() << " " << ( hexagon.cell( 1 ) == hexagon.cell( 5 ) and hexagon.cell( 2 ) == hexagon.cell( 4 ) and hexagon.cell( 1 ) != hexagon.cell( 3 ) ) << std::endl;
+	std::cout << ( D.refinesOrbits() and Orbitals( W->generators(), 6 ).refinesOrbits() and not Orbitals( S6->generators(), 6 ).refinesOrbits() ) << std::endl;
+
+	// searches in S_4 wr S_3, whose orbitals tell pairs in one block from pairs in different blocks
+	Group S12( new SymmetricGroup( 12 ) );
+	std::vector<Permutation> wreath = { {1,2,3,0,4,5,6,7,8,9,10,11}, {1,0,2,3,4,5,6,7,8,9,10,11}, {4,5,6,7,8,9,10,11,0,1,2,3}, {4,5,6,7,0,1,2,3,8,9,10,11} };
+	Group X( new Subgroup( S12, wreath ) );
+	std::vector<int> points = { 0, 1, 4, 5, 8 };
+	Group Y = X->setStabilizer( points );
+	bool stabilises = true;
+	for( const Permutation& sigma : Y->generators() )
+		for( int x : points )
+			stabilises = stabilises and std::count( points.begin(), points.end(), sigma( x ) ) == 1;
+	std::cout << int( Y->order() ) << " " << stabilises << std::endl;
+	// the intersection with a conjugate, whose blocks meet every block of X in two points
+	Permutation d( {0,4,8,1,5,9,2,6,10,3,7,11} );
+	std::vector<Permutation> conjugates;
+	for( const Permutation& sigma : wreath )
+		conjugates.push_back( d * sigma * d.inverse() );
+	Group Z( new Subgroup( S12, conjugates ) );
+	Group I = X->intersection( Z );
+	std::cout << int( I->order() ) << " " << ( X->hasSubgroup( I ) and Z->hasSubgroup( I ) ) << std::endl;
+
+	std::cout << "------------------------------" << std::endl;
+	// pointwise stabilisers and stabilizer chains
+	std::cout << int( W->pointwiseStabilizer( { 0, 3 } )->order() ) << std::endl;
+	std::vector<Group> chain = W->stabilizerChain( { 0, 3 } );
+	std::cout << chain.size() << " " << int( chain[0]->order() ) << " " << int( chain[1]->order() ) << " " << int( chain[2]->order() ) << std::endl;
+	std::cout << ( chain[2]->contains( {0,2,1,3,5,4} ) and not chain[2]->contains( {0,1,2,4,3,5} ) ) << std::endl;
+
+	// the stabilisers of a symmetric group are read off a chain known in closed form
+	Group S200( new SymmetricGroup( 200 ) );
+	std::vector<Group> stabilizers = S200->stabilizerChain( { 7, 3, 199 } );
+	bool symmetric = true;
+	for( int k = 0; k <= 3; ++k )
+		symmetric = symmetric and stabilizers[k]->exactOrder() == SymmetricGroup( 200 - k ).exactOrder();
+	Group T = S200->pointwiseStabilizer( { 7, 3 } );
+	std::cout << ( symmetric and T->exactOrder() == stabilizers[2]->exactOrder() and T->contains( S200->generators()[1] ) and not T->contains( S200->generators()[0] ) ) << std::endl;
+
+	std::cout << "------------------------------" << std::endl;
+	// kernels of actions
+	auto B = NaturalAction( W ).systemOfImprimitivity();
+	std::cout << int( B.calculateKernel()->order() ) << " " << W->setStabilizer( { 0, 1, 2 } )->hasSubgroup( B.kernel() ) << std::endl;
+	std::cout << int( NaturalAction( W ).calculateKernel()->order() ) << " " << int( NaturalSetAction( W, 6, 2 ).calculateKernel()->order() ) << std::endl;
+
+	std::cout << "------------------------------" << std::endl;
+	// structured predicates are recognized: their subgroups are computed from their structure
+	auto fixes3 = []( const Permutation& sigma ) -> bool { return sigma( 3 ) == 3; };
+	std::cout << ( has_coset_invariant<PointStabilizerPredicate>::value and has_structured_subgroup<SetStabilizerPredicate>::value and has_structured_subgroup<MembershipPredicate>::value and not has_coset_invariant<decltype( fixes3 )>::value ) << std::endl;
+	Group S60( new SymmetricGroup( 60 ) );
+	std::vector<int> ten = { 0, 6, 12, 18, 24, 30, 36, 42, 48, 54 };
+	Group U( new Subgroup( S60, SetStabilizerPredicate( 60, ten ) ) );
+	std::cout << ( U->exactOrder() == SymmetricGroup( 10 ).exactOrder() * SymmetricGroup( 50 ).exactOrder() ) << std::endl;
+	Group V( new Subgroup( W, PointStabilizerPredicate( 0 ) ) ), M( new Subgroup( W, MembershipPredicate( A6 ) ) );
+	std::cout << int( V->order() ) << " " << ( V->hasSubgroup( W->stabilizer( 0 ) ) and W->stabilizer( 0 )->hasSubgroup( V ) ) << " " << int( M->order() ) << std::endl;
+
+	// the generator starts its table with the subgroup, and buckets the coset representatives by the invariant
+	SubgroupGenerator structured( S7, PointStabilizerPredicate( 3 ) ), plain( S7, fixes3 );
+	Group F( new Subgroup( S7, structured.subgroupGenerators() ) );
+	std::cout << structured.cosetRepresentatives().size() << " " << plain.cosetRepresentatives().size() << " " << int( F->order() ) << std::endl;
+	std::set<int> images;
+	for( const Permutation& sigma : structured.cosetRepresentatives() )
+		images.insert( sigma.inverse()( 3 ) );
+	std::cout << images.size() << std::endl;
+
+	return 0;
+}
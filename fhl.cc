@@ -1,6 +1,77 @@
+#include <algorithm>
+
 #include "permutation.h"
 #include "fhl.h"
 
+void FHLTable::reset( size_t rows ) {
+	_rows.assign( rows, row() );
+	_size = 0;
+}
+
+size_t FHLTable::rows() const {
+	return _rows.size();
+}
+
+int FHLTable::get( size_t i, int j ) const {
+	const row& r = _rows[i];
+	auto it = std::lower_bound( r.images.begin(), r.images.end(), j );
+	if( it == r.images.end() or *it != j )
+		return -1;
+	return r.slots[ it - r.images.begin() ];
+}
+
+void FHLTable::set( size_t i, int j, int slot ) {
+	row& r = _rows[i];
+	auto it = std::lower_bound( r.images.begin(), r.images.end(), j );
+	r.slots.insert( r.slots.begin() + ( it - r.images.begin() ), slot );
+	r.images.insert( it, j );
+	++_size;
+}
+
+size_t FHLTable::occupancy( size_t i ) const {
+	return _rows[i].images.size();
+}
+
+size_t FHLTable::size() const {
+	return _size;
+}
+
+const std::vector<int>& FHLTable::slots( size_t i ) const {
+	return _rows[i].slots;
+}
+
+bool FHLTable::next( size_t& i, int& j ) const {
+	for( ; i < _rows.size(); ++i, j = -1 ) {
+		const std::vector<int>& images = _rows[i].images;
+		auto it = std::upper_bound( images.begin(), images.end(), j );
+		if( it != images.end() ) {
+			j = *it;
+			return true;
+		}
+	}
+	return false;
+}
+
+void FHLTable::write( BinaryWriter& out ) const {
+	out.write<uint64_t>( _rows.size() );
+	for( const row& r : _rows ) {
+		out.write( r.images );
+		out.write( r.slots );
+	}
+}
+
+void FHLTable::read( BinaryReader& in ) {
+	reset( in.read<uint64_t>() );
+	for( row& r : _rows ) {
+		r.images = in.readVector<int>();
+		r.slots = in.readVector<int>();
+		_size += r.images.size();
+	}
+}
+
+FHLTable::FHLTable() : _size( 0 ) {
+}
+
 bool PermutationPullback::isIdentity() const {
 	return original.isIdentity();
 }
@@ -25,110 +96,470 @@ PermutationPullback PermutationPullback::operator*( const PermutationPullback& o
 	return PermutationPullback( std::move( original * other.original ), std::move( pullback * other.pullback ) );
 }
 
+PermutationPullback& PermutationPullback::leftMultiplyInPlace( PermutationPullbackRef other ) {
+	original.leftMultiplyInPlace( other.original );
+	pullback.leftMultiplyInPlace( other.pullback );
+	return *this;
+}
+
+void PermutationPullback::invertInto( PermutationPullback& dst ) const {
+	original.invertInto( dst.original );
+	pullback.invertInto( dst.pullback );
+}
+
+void PermutationPullback::composeInto( PermutationPullback& dst, PermutationPullbackRef a, PermutationPullbackRef b ) {
+	Permutation::composeInto( dst.original, a.original, b.original );
+	Permutation::composeInto( dst.pullback, a.pullback, b.pullback );
+}
+
+PermutationPullback::operator PermutationPullbackRef() const {
+	return PermutationPullbackRef( original, pullback );
+}
+
+PermutationPullback::PermutationPullback( PermutationPullbackRef r ) : original( r.original ), pullback( r.pullback ) {
+}
+
 PermutationPullback::PermutationPullback( Permutation&& o, Permutation&& p ) : original( std::move( o ) ), pullback( std::move( p ) ) {
 }
 
 PermutationPullback::PermutationPullback( Permutation p ) : original( p ), pullback( std::move( p ) ) {
 }
 
-PullbackStructure::PullbackStructure( Group pullback_space, const std::vector<PermutationPullback>& generators ) : FHL<PermutationPullback>( generators, generators.front().degree() ) {
-	domain = pullback_space; 
+bool PermutationPullbackRef::isIdentity() const {
+	return original.isIdentity();
 }
 
-PullbackStructure::PullbackStructure( Group pullback_space, std::vector<Permutation> originals, std::vector<Permutation> pullbacks ) {
-	domain = pullback_space;
-	std::vector<PermutationPullback> generators;
+int PermutationPullbackRef::degree() const {
+	return original.degree();
+}
+
+int PermutationPullbackRef::operator()( int i ) const {
+	return original( i );
+}
+
+void PermutationPullbackRef::invertInto( PermutationPullback& dst ) const {
+	original.invertInto( dst.original );
+	pullback.invertInto( dst.pullback );
+}
+
+PermutationPullbackRef::PermutationPullbackRef( PermutationRef o, PermutationRef p ) : original( o ), pullback( p ) {
+}
+
+size_t PermutationPullbackArena::size() const {
+	return original.size();
+}
+
+PermutationPullbackRef PermutationPullbackArena::operator[]( size_t i ) const {
+	return PermutationPullbackRef( original[i], pullback[i] );
+}
+
+void PermutationPullbackArena::adopt( PermutationPullbackRef sigma ) {
+	if( pullback.size() == 0 and pullback.degree() != sigma.pullback.degree() )
+		pullback.reset( sigma.pullback.degree() );
+}
+
+size_t PermutationPullbackArena::push( PermutationPullbackRef sigma ) {
+	adopt( sigma );
+	pullback.push( sigma.pullback );
+	return original.push( sigma.original );
+}
+
+size_t PermutationPullbackArena::pushInverse( PermutationPullbackRef sigma ) {
+	adopt( sigma );
+	pullback.pushInverse( sigma.pullback );
+	return original.pushInverse( sigma.original );
+}
+
+void PermutationPullbackArena::reset( int n ) {
+	original.reset( n );
+	pullback.reset( n );
+}
+
+PermutationPullbackArena::PermutationPullbackArena( int n, bool huge_pages ) : original( n, huge_pages ), pullback( n, huge_pages ) {
+}
+
+const int StraightLineProgram::identity;
+
+int StraightLineProgram::generator( int k ) {
+	code.push_back( { -1, k } );
+	return code.size() - 1;
+}
+
+int StraightLineProgram::inverse( int a ) {
+	if( a == identity )
+		return identity;
+	if( code[a].left >= 0 and code[a].right < 0 )
+		return code[a].left;
+	code.push_back( { a, -1 } );
+	return code.size() - 1;
+}
+
+int StraightLineProgram::product( int a, int b ) {
+	if( a == identity )
+		return b;
+	if( b == identity )
+		return a;
+	code.push_back( { a, b } );
+	return code.size() - 1;
+}
+
+size_t StraightLineProgram::size() const {
+	return code.size();
+}
+
+std::vector<Permutation> StraightLineProgram::evaluate( const std::vector<int>& targets, const std::vector<Permutation>& images, int n, size_t* width ) const {
+	// uses counts the consumers of every instruction the targets depend on, the targets included.
+	// operands precede their instructions, so these are evaluated in increasing order, and a value
+	// is dropped as soon as its last consumer has been evaluated
+	std::unordered_map<int,int> uses;
+	std::vector<int> needed, stack;
+	for( int a : targets )
+		if( a != identity and uses[a]++ == 0 )
+			stack.push_back( a );
+	while( not stack.empty() ) {
+		int b = stack.back();
+		stack.pop_back();
+		needed.push_back( b );
+		const instruction& x = code[b];
+		if( x.left >= 0 )
+			for( int c : { x.left, x.right } )
+				if( c >= 0 and uses[c]++ == 0 )
+					stack.push_back( c );
+	}
+	std::sort( needed.begin(), needed.end() );
+	std::unordered_map<int,Permutation> live;
+	size_t peak = 0;
+	auto release = [&]( int b ) {
+		if( --uses[b] == 0 )
+			live.erase( b );
+	};
+	for( int b : needed ) {
+		const instruction& x = code[b];
+		if( x.left < 0 )
+			live.emplace( b, images[x.right] );
+		else if( x.right < 0 )
+			live.emplace( b, live.at( x.left ).inverse() );
+		else
+			live.emplace( b, live.at( x.left ) * live.at( x.right ) );
+		peak = std::max( peak, live.size() );
+		if( x.left >= 0 ) {
+			release( x.left );
+			if( x.right >= 0 )
+				release( x.right );
+		}
+	}
+	if( width )
+		*width = peak;
+	std::vector<Permutation> R;
+	R.reserve( targets.size() );
+	for( int a : targets ) {
+		if( a == identity ) {
+			R.emplace_back( n );
+			continue;
+		}
+		auto it = live.find( a );
+		if( --uses[a] == 0 ) {
+			R.push_back( std::move( it->second ) );
+			live.erase( it );
+		} else
+			R.push_back( it->second );
+	}
+	return R;
+}
+
+void StraightLineProgram::compact( std::vector<int>& words ) {
+	// operands precede their instructions, so a backward pass marks everything the words use
+	std::vector<char> used( code.size(), false );
+	for( int a : words )
+		if( a != identity )
+			used[a] = true;
+	for( size_t b = code.size(); b-- > 0; )
+		if( used[b] and code[b].left >= 0 ) {
+			used[ code[b].left ] = true;
+			if( code[b].right >= 0 )
+				used[ code[b].right ] = true;
+		}
+	std::vector<int> index( code.size(), identity );
+	size_t k = 0;
+	for( size_t b = 0; b < code.size(); ++b ) {
+		if( not used[b] )
+			continue;
+		instruction x = code[b];
+		if( x.left >= 0 ) {
+			x.left = index[x.left];
+			if( x.right >= 0 )
+				x.right = index[x.right];
+		}
+		index[b] = k;
+		code[k++] = x;
+	}
+	code.resize( k );
+	code.shrink_to_fit();
+	for( int& a : words )
+		if( a != identity )
+			a = index[a];
+}
+
+// --------------------------------------------------------------------------------------------------------------
+
+int WordPullback::getWord() const {
+	return word;
+}
+
+bool WordPullback::isIdentity() const {
+	return original.isIdentity();
+}
+
+int WordPullback::degree() const {
+	return original.degree();
+}
+
+int WordPullback::operator()( int i ) const {
+	return original( i );
+}
+
+WordPullback& WordPullback::leftMultiplyInPlace( WordPullbackRef other ) {
+	original.leftMultiplyInPlace( other.original );
+	if( other.program )
+		program = other.program;
+	word = program ? program->product( other.word, word ) : StraightLineProgram::identity;
+	return *this;
+}
+
+void WordPullback::invertInto( WordPullback& dst ) const {
+	WordPullbackRef( *this ).invertInto( dst );
+}
+
+void WordPullback::composeInto( WordPullback& dst, WordPullbackRef a, WordPullbackRef b ) {
+	Permutation::composeInto( dst.original, a.original, b.original );
+	dst.program = a.program ? a.program : b.program;
+	dst.word = dst.program ? dst.program->product( a.word, b.word ) : StraightLineProgram::identity;
+}
+
+WordPullback::operator WordPullbackRef() const {
+	return WordPullbackRef( original, word, program );
+}
+
+WordPullback::WordPullback( WordPullbackRef r ) : original( r.original ), word( r.word ), program( r.program ) {
+}
+
+WordPullback::WordPullback( Permutation p ) : original( std::move( p ) ), word( StraightLineProgram::identity ), program( nullptr ) {
+}
+
+WordPullback::WordPullback( Permutation p, int w, StraightLineProgram* P ) : original( std::move( p ) ), word( w ), program( P ) {
+}
+
+int WordPullbackRef::getWord() const {
+	return word;
+}
+
+bool WordPullbackRef::isIdentity() const {
+	return original.isIdentity();
+}
+
+int WordPullbackRef::degree() const {
+	return original.degree();
+}
+
+int WordPullbackRef::operator()( int i ) const {
+	return original( i );
+}
+
+void WordPullbackRef::invertInto( WordPullback& dst ) const {
+	original.invertInto( dst.original );
+	dst.program = program;
+	dst.word = program ? program->inverse( word ) : StraightLineProgram::identity;
+}
+
+WordPullbackRef::WordPullbackRef( PermutationRef o, int w, StraightLineProgram* P ) : original( o ), word( w ), program( P ) {
+}
+
+size_t WordPullbackArena::size() const {
+	return original.size();
+}
+
+WordPullbackRef WordPullbackArena::operator[]( size_t i ) const {
+	return WordPullbackRef( original[i], words[i], program );
+}
+
+size_t WordPullbackArena::push( WordPullbackRef sigma ) {
+	if( sigma.program )
+		program = sigma.program;
+	words.push_back( sigma.word );
+	return original.push( sigma.original );
+}
+
+size_t WordPullbackArena::pushInverse( WordPullbackRef sigma ) {
+	if( sigma.program )
+		program = sigma.program;
+	words.push_back( program ? program->inverse( sigma.word ) : StraightLineProgram::identity );
+	return original.pushInverse( sigma.original );
+}
+
+void WordPullbackArena::reset( int n ) {
+	original.reset( n );
+	words.clear();
+}
+
+void WordPullbackArena::compact() {
+	if( program )
+		program->compact( words );
+}
+
+WordPullbackArena::WordPullbackArena( int n, bool huge_pages ) : original( n, huge_pages ), program( nullptr ) {
+}
+
+// --------------------------------------------------------------------------------------------------------------
+
+void PullbackStructure::initialise( std::vector<Permutation> originals, std::vector<Permutation> pullbacks ) {
+	program = std::make_shared<StraightLineProgram>();
+	images = std::move( pullbacks );
+	std::vector<WordPullback> generators;
 	generators.reserve( originals.size() );
-	for( size_t i = 0; i < originals.size(); ++i )
-		generators.emplace_back( std::move( originals[i] ), std::move( pullbacks[i] ) );
+	for( size_t k = 0; k < originals.size(); ++k )
+		generators.emplace_back( std::move( originals[k] ), program->generator( k ), program.get() );
 	create( generators, generators.front().degree() );
+	// the products of the closure that sifted away, or were sifted further, left instructions no cell uses
+	A.compact();
+	values.assign( A.size(), Lazy<std::shared_ptr<const Permutation>>() );
 }
 
-Permutation PullbackStructure::operator()( Permutation sigma ) const {
-	return find( PermutationPullback( std::move( sigma ), std::move( domain->one() ) ) ).getPullback();
+PullbackStructure::PullbackStructure( Group pullback_space, const std::vector<PermutationPullback>& generators ) {
+	domain = pullback_space;
+	std::vector<Permutation> originals, pullbacks;
+	for( const PermutationPullback& sigma : generators ) {
+		originals.push_back( sigma.original );
+		pullbacks.push_back( sigma.pullback );
+	}
+	initialise( std::move( originals ), std::move( pullbacks ) );
 }
 
-// --------------------------------------------------------------------------------------------------------------
+PullbackStructure::PullbackStructure( Group pullback_space, std::vector<Permutation> originals, std::vector<Permutation> pullbacks ) {
+	domain = pullback_space;
+	initialise( std::move( originals ), std::move( pullbacks ) );
+}
 
-Permutation SubgroupGenerator::filter( Permutation sigma, bool add ) const {
-	if( check( sigma ) )
-		return FHL<>::filter( sigma, add );
-	for( const Permutation& tau : representatives ) {
-		Permutation mu( tau * sigma );
-		if( check( mu ) )
-			return FHL<>::filter( mu, add );
+std::vector<int> PullbackStructure::path( Permutation& tau ) const {
+	std::vector<int> P;
+	for( size_t i = 0; i < m; ++i ) {
+		int j = tau( i );
+		if( j != int( i ) ) {
+			int slot = V.get( i, j );
+			if( slot < 0 )
+				break;
+			tau.leftMultiplyInPlace( A[slot].original );
+			P.push_back( slot );
+		}
 	}
-	Permutation nu = sigma.inverse();
-	if( add )
-		representatives.push_back( nu );
+	return P;
+}
+
+void PullbackStructure::evaluate( std::vector<int> slots ) const {
+	std::sort( slots.begin(), slots.end() );
+	slots.erase( std::unique( slots.begin(), slots.end() ), slots.end() );
+	std::vector<int> missing, targets;
+	for( int slot : slots )
+		if( not values[slot].ready() ) {
+			missing.push_back( slot );
+			targets.push_back( A[slot].getWord() );
+		}
+	if( missing.empty() )
+		return;
+	// another thread may evaluate the same cells meanwhile, the value set first is kept
+	std::vector<Permutation> R = program->evaluate( targets, images, domain->degree() );
+	for( size_t k = 0; k < missing.size(); ++k )
+		values[ missing[k] ].get( [&]() { return std::make_shared<const Permutation>( std::move( R[k] ) ); } );
+}
+
+Permutation PullbackStructure::pullback( const std::vector<int>& path ) const {
+	// sifting multiplied sigma from the left by the cells on its path, down to the identity,
+	// so its pullback is the inverse of the product of their pullbacks
+	Permutation r = domain->one();
+	for( int slot : path )
+		r.leftMultiplyInPlace( *values[slot].value() );
+	return r.inverse();
+}
+
+Permutation PullbackStructure::operator()( Permutation sigma ) const {
+	std::vector<int> P = path( sigma );
+	evaluate( P );
+	return pullback( P );
+}
+
+std::vector<Permutation> PullbackStructure::operator()( const std::vector<Permutation>& S ) const {
+	// the table is walked once per level for the whole batch, and the cells shared by the
+	// paths are evaluated once, together with the instructions they have in common
+	std::vector<Permutation> W( S );
+	std::vector<std::vector<int>> paths( S.size() );
+	std::vector<size_t> alive( S.size() ), next;
+	for( size_t k = 0; k < S.size(); ++k )
+		alive[k] = k;
+	for( size_t i = 0; i < m and not alive.empty(); ++i ) {
+		next.clear();
+		for( size_t k : alive ) {
+			int j = W[k]( i );
+			if( j != int( i ) ) {
+				int slot = V.get( i, j );
+				if( slot < 0 )
+					continue;
+				W[k].leftMultiplyInPlace( A[slot].original );
+				paths[k].push_back( slot );
+			}
+			next.push_back( k );
+		}
+		std::swap( alive, next );
+	}
+	std::vector<int> slots;
+	for( const auto& P : paths )
+		slots.insert( slots.end(), P.begin(), P.end() );
+	evaluate( slots );
+	std::vector<Permutation> R;
+	R.reserve( S.size() );
+	for( const auto& P : paths )
+		R.push_back( pullback( P ) );
+	return R;
+}
+
+bool PullbackStructure::contains( const Permutation& sigma ) const {
+	return find( sigma ).isIdentity();
+}
+
+Permutation PullbackStructure::find( Permutation sigma ) const {
+	path( sigma );
 	return sigma;
 }
 
-SubgroupGenerator::SubgroupGenerator( Group H, std::function<bool(Permutation)> func ) {
-	create( H, func );
+const StraightLineProgram& PullbackStructure::words() const {
+	return *program;
+}
+
+// --------------------------------------------------------------------------------------------------------------
+
+Permutation SubgroupGenerator::filter( Permutation sigma, bool add ) const {
+	return filter( check, std::move( sigma ), add );
 }
 
 void SubgroupGenerator::clear() {
-	representatives.clear();
+	representatives.reset( 0 );
+	representative_index.clear();
+	representative_buckets.clear();
 	FHL<>::clear();
 	check = nullptr;
+	invariant = nullptr;
 }
 
-void SubgroupGenerator::create( Group H, const FHL<Permutation>& P ) {
+std::vector<Permutation> SubgroupGenerator::prepare( Group H, bool par ) {
 	clear();
 	G = H;
-	check = [&]( const Permutation& sigma ) -> bool { return P.contains( sigma ); };
-	n = G->generators().back().degree();
+	parallel = par;
+	std::vector<Permutation> generators = G->generators();
+	n = generators.back().degree();
 	m = n - 1;
-	subcreate();
-}
-
-void SubgroupGenerator::subcreate() {
-	auto generators = G->generators();
-	if( n > 0 ) {
-		V.resize( m );
-		for( size_t i = 0; i < m; ++i )
-			V[i].resize( m - i, Permutation( 0 ) );
-		std::deque<Permutation> new_permutations;
-		for( auto sigma : generators )
-			new_permutations.push_back( filter( sigma, true ) );
-		while( not new_permutations.empty() ) {
-			Permutation sigma = std::move( new_permutations.front() );
-			Permutation mu( 0 );
-			new_permutations.pop_front();
-			for( const auto& W : V ) {
-				for( const auto& tau : W ) {
-					if( tau.degree() > 0 ) {
-						Permutation nu = tau.inverse();
-						mu = filter( sigma * nu, true );
-						if( not mu.isIdentity() )
-							new_permutations.push_back( std::move( mu ) );
-						mu = filter( nu * sigma, true );
-						if( not mu.isIdentity() )
-							new_permutations.push_back( std::move( mu ) );
-					}
-				}
-			}
-			for( size_t p = 0; p < representatives.size(); ++p ) {
-				Permutation nu = representatives[p].inverse();
-				mu = filter( sigma * nu, true );
-				if( not mu.isIdentity() )
-					new_permutations.push_back( std::move( mu ) );
-				mu = filter( nu * sigma, true );
-				if( not mu.isIdentity() )
-					new_permutations.push_back( std::move( mu ) );
-			}
-		}
-	}
+	return generators;
 }
 
-void SubgroupGenerator::create( Group H, std::function<bool(Permutation)> func ) {
-	clear();
-	G = H;
-	check = func;
-	n = G->generators().back().degree();
-	m = n - 1;
-	subcreate();
+void SubgroupGenerator::create( Group H, const FHL<Permutation>& P, bool par ) {
+	create( H, [&P]( const Permutation& sigma ) -> bool { return P.contains( sigma ); }, par );
 }
 
 bool SubgroupGenerator::contains( const Permutation& sigma ) const {
@@ -140,11 +571,20 @@ Permutation SubgroupGenerator::find( const Permutation& sigma ) const {
 }
 
 Subgroup SubgroupGenerator::subgroup() const {
-	return Subgroup( G, listGenerators() );
+	return Subgroup( G, subgroupGenerators() );
+}
+
+std::vector<Permutation> SubgroupGenerator::subgroupGenerators() const {
+	GeneratorReduction reduction = StabilizerChain::defaults().reduction;
+	if( reduction != GeneratorReduction::none )
+		return reduceGenerators( listGenerators(), G->degree(), reduction );
+	return listGenerators();
 }
 
 std::deque<Permutation> SubgroupGenerator::cosetRepresentatives() const {
-	std::deque<Permutation> r = representatives;
+	std::deque<Permutation> r;
+	for( size_t p = 0; p < representatives.size(); ++p )
+		r.emplace_back( representatives[p] );
 	r.push_back( G->one() );
 	return r;
 }
\ No newline at end of file
@@ -2,7 +2,12 @@
 
 #include <vector>
 #include <deque>
+#include <unordered_map>
+#include <tuple>
+#include <functional>
+#include <type_traits>
 #include "permutation.h"
+#include "multi.h"
 
 template<typename T = Permutation>
 class FHL;
@@ -13,24 +18,232 @@ std::ostream& operator<<( std::ostream& os, const FHL<T>& fhl );
 class PermutationPullback;
 class SubgroupGenerator;
 class PullbackStructure;
+class _Group;
+
+// checks whether P can be called as a predicate on permutations, see SubgroupGenerator
+template<typename P, typename = void>
+struct is_permutation_predicate : std::false_type {};
+template<typename P>
+struct is_permutation_predicate<P, decltype( void( bool( std::declval<const P&>()( std::declval<const Permutation&>() ) ) ) )> : std::true_type {};
+
+// checks whether a predicate provides a coset invariant, see SubgroupGenerator::invariant_type
+template<typename P, typename = void>
+struct has_coset_invariant : std::false_type {};
+template<typename P>
+struct has_coset_invariant<P, decltype( void( uint64_t( std::declval<const P&>().invariant( std::declval<const Permutation&>() ) ) ) )> : std::true_type {};
+
+// checks whether a predicate computes the subgroup it describes from its structure, see predicates.h
+template<typename P, typename = void>
+struct has_structured_subgroup : std::false_type {};
+template<typename P>
+struct has_structured_subgroup<P, decltype( void( std::shared_ptr<const _Group>( std::declval<const P&>().subgroupOf( std::declval<std::shared_ptr<const _Group>>() ) ) ) )> : std::true_type {};
 
 #include "permutation.h"
+#include "permutation_arena.h"
+#include "serialization.h"
 #include "ext.h"
 
+class PermutationPullbackRef;
+class PermutationPullbackArena;
+
 class PermutationPullback {
+	friend class PermutationPullbackRef;
+	friend class PermutationPullbackArena;
+	friend class PullbackStructure;
 	Permutation original;
 	Permutation pullback;
 public:
+	typedef PermutationPullbackRef reference;
+	typedef PermutationPullbackArena arena_type;
 	Permutation getPullback() const;
 	bool isIdentity() const;
 	int degree() const;
 	PermutationPullback inverse() const;
 	int operator()( int ) const;
 	PermutationPullback operator*( const PermutationPullback& ) const;
+	PermutationPullback& leftMultiplyInPlace( PermutationPullbackRef );
+	void invertInto( PermutationPullback& ) const;
+	static void composeInto( PermutationPullback&, PermutationPullbackRef, PermutationPullbackRef );
+	operator PermutationPullbackRef() const;
+	explicit PermutationPullback( PermutationPullbackRef );
 	PermutationPullback( Permutation );
 	PermutationPullback( Permutation&&, Permutation&& );
 };
 
+// view of a PermutationPullback stored elsewhere
+class PermutationPullbackRef {
+	friend class PermutationPullback;
+	friend class PermutationPullbackArena;
+	PermutationRef original;
+	PermutationRef pullback;
+public:
+	bool isIdentity() const;
+	int degree() const;
+	int operator()( int ) const;
+	void invertInto( PermutationPullback& ) const;
+	PermutationPullbackRef( PermutationRef, PermutationRef );
+};
+
+// contiguous storage for pullback pairs, one arena for either component
+// the pullbacks may have a different degree, which is taken from the first pair stored
+class PermutationPullbackArena {
+	PermutationArena original;
+	PermutationArena pullback;
+	void adopt( PermutationPullbackRef );
+public:
+	size_t size() const;
+	PermutationPullbackRef operator[]( size_t ) const;
+	size_t push( PermutationPullbackRef );
+	size_t pushInverse( PermutationPullbackRef );
+	void reset( int n );
+	PermutationPullbackArena( int n = 0, bool huge_pages = false );
+};
+
+// straight-line program over the generators of a group
+// *************************************************************
+// Every instruction is a generator, the inverse of an earlier
+// instruction or the product of two earlier ones, so a word of
+// any length is a single index. Programs grow with every product
+// until compact drops the instructions no kept word depends on.
+// Evaluating instructions for given images of the generators
+// walks the instructions they depend on once each, whatever the
+// length of the words they spell, and keeps an intermediate
+// value only until its last use.
+// *************************************************************
+class StraightLineProgram {
+	struct instruction {
+		int left;  // -1 for a generator
+		int right; // the generator, -1 for an inverse
+	};
+	std::vector<instruction> code;
+public:
+	// the instruction evaluating to the identity
+	static const int identity = -1;
+
+	// return the instruction for generator k, the inverse of a and the product a * b
+	int generator( int k );
+	int inverse( int a );
+	int product( int a, int b );
+
+	// returns the number of instructions
+	size_t size() const;
+
+	// evaluates the instructions in targets with the given images of the generators, all of degree n
+	// when width is given, the largest number of values held at once is stored in it
+	std::vector<Permutation> evaluate( const std::vector<int>& targets, const std::vector<Permutation>& images, int n, size_t* width = nullptr ) const;
+
+	// removes the instructions none of the words depends on and renumbers the words accordingly
+	void compact( std::vector<int>& words );
+};
+
+class WordPullbackRef;
+class WordPullbackArena;
+
+// permutation together with a word for it in a straight-line program
+// a PullbackStructure builds its table from these, so multiplying costs one composition and one instruction
+class WordPullback {
+	friend class WordPullbackRef;
+	friend class WordPullbackArena;
+	Permutation original;
+	int word;
+	StraightLineProgram* program;
+public:
+	typedef WordPullbackRef reference;
+	typedef WordPullbackArena arena_type;
+	int getWord() const;
+	bool isIdentity() const;
+	int degree() const;
+	int operator()( int ) const;
+	WordPullback& leftMultiplyInPlace( WordPullbackRef );
+	void invertInto( WordPullback& ) const;
+	static void composeInto( WordPullback&, WordPullbackRef, WordPullbackRef );
+	operator WordPullbackRef() const;
+	explicit WordPullback( WordPullbackRef );
+	WordPullback( Permutation );
+	WordPullback( Permutation, int, StraightLineProgram* );
+};
+
+// view of a WordPullback stored elsewhere
+class WordPullbackRef {
+	friend class WordPullback;
+	friend class WordPullbackArena;
+	friend class PullbackStructure;
+	PermutationRef original;
+	int word;
+	StraightLineProgram* program;
+public:
+	int getWord() const;
+	bool isIdentity() const;
+	int degree() const;
+	int operator()( int ) const;
+	void invertInto( WordPullback& ) const;
+	WordPullbackRef( PermutationRef, int, StraightLineProgram* );
+};
+
+// contiguous storage for word pullbacks, the words of a single program
+class WordPullbackArena {
+	PermutationArena original;
+	std::vector<int> words;
+	StraightLineProgram* program;
+public:
+	size_t size() const;
+	WordPullbackRef operator[]( size_t ) const;
+	size_t push( WordPullbackRef );
+	size_t pushInverse( WordPullbackRef );
+	void reset( int n );
+
+	// compacts the program to the instructions used by the stored words
+	void compact();
+	WordPullbackArena( int n = 0, bool huge_pages = false );
+};
+
+// sparse table of the cells of an FHL structure
+// *************************************************************
+// Cell (i,j) with j > i holds the permutation mapping j to i and
+// fixing 0,...,i-1. Only occupied cells are stored: row i keeps
+// their images j in increasing order next to the slots of their
+// permutations, so memory and scans are proportional to the
+// number of occupied cells instead of n^2/2. Cells are never
+// emptied, which lets next() walk the table while it grows.
+// *************************************************************
+class FHLTable {
+	struct row {
+		std::vector<int> images; // occupied cells, increasing
+		std::vector<int> slots;  // slot of the permutation of each occupied cell
+	};
+	std::vector<row> _rows;
+	size_t _size;
+public:
+	// empties the table and sets the number of rows
+	void reset( size_t rows );
+
+	// returns the number of rows
+	size_t rows() const;
+
+	// returns the slot of cell (i,j), -1 when it is empty
+	int get( size_t i, int j ) const;
+
+	// fills the empty cell (i,j)
+	void set( size_t i, int j, int slot );
+
+	// returns the number of occupied cells in row i, respectively in the table
+	size_t occupancy( size_t i ) const;
+	size_t size() const;
+
+	// returns the slots of the occupied cells of row i, by increasing image
+	const std::vector<int>& slots( size_t i ) const;
+
+	// moves (i,j) to the next occupied cell in table order, starting from (0,-1)
+	// returns false when there is none, cells filled behind (i,j) are not visited
+	bool next( size_t& i, int& j ) const;
+
+	// stores the table in a structure file, see serialization.h
+	void write( BinaryWriter& out ) const;
+	void read( BinaryReader& in );
+
+	FHLTable();
+};
+
 // *************************************************************
 // T should have the following:
 //   - An implicit cast to and from Permutation;
@@ -38,7 +251,15 @@ public:
 //     commutes with casts to Permutation;
 //   - An operator() evaluation of integers that commutes with
 //     casts to Permutation;
-//   - Multiplication that commutes with cast to Permutation.
+//   - Multiplication that commutes with cast to Permutation;
+//   - In-place variants leftMultiplyInPlace, invertInto and
+//     composeInto of multiplication and inversion.
+//   - A view type T::reference, to which T implicitly casts and
+//     from which T can be constructed, accepted by the in-place
+//     operations;
+//   - A type T::arena_type storing many values of T of a single
+//     degree contiguously, with push, pushInverse, reset and
+//     operator[] returning a T::reference.
 // Permutation itself trivially satisfies these conditions
 // *************************************************************
 
@@ -46,18 +267,34 @@ template<typename T>
 class FHL {
 protected:
 	friend std::ostream& operator<<<>( std::ostream& os, const FHL<T>& fhl );
-	mutable std::vector<std::vector<T>> V; // very important permutations
+	mutable FHLTable V; // slots in A of very important permutations
+	mutable typename T::arena_type A;
 	size_t n, m;
+	bool parallel;
 
 	// takes a permutation and writes it as a product of coset representatives if possible.
 	// if not, it adds the modified permutation to a list of coset representatives when add=true.
 	T filter( T sigma, bool add ) const;
+
+	// in-place version of filter starting at level first, sigma is replaced by the filtrate
+	// returns the level where sigma dropped out, or m when it sifted through
+	size_t sift( T& sigma, bool add, size_t first = 0 ) const;
+
+	// returns the slots of all non-empty cells in table order
+	std::vector<int> cells() const;
+
+	// runs the closure of create in batches whose sifts are spread over THREADS threads
+	void closeParallel( std::deque<T>& new_permutations );
 public:
+	// number of products sifted per batch by the parallel closure
+	static const size_t batch_size = 4096;
+
 	// clears all data in the structure
 	void clear();
 
-	// initialises the structure using S as generators with degree d 
-	void create( std::vector<T> S, size_t d );
+	// initialises the structure using S as generators with degree d
+	// with parallel=true the closure sifts batches of products concurrently; the result does not depend on the number of threads
+	void create( std::vector<T> S, size_t d, bool parallel = false );
 
 	// checks whether sigma is an element of the group encoded by this structure
 	bool contains( const T& sigma ) const;
@@ -70,6 +307,7 @@ public:
 
 	// computes the order of the group encoded by this structure
 	__int128_t order() const;
+	natural exactOrder() const;
 
 	// returns a list of O(n^2) generators for the group encoded by this structure
 	std::vector<T> listGenerators() const;
@@ -77,6 +315,11 @@ public:
 	// checks whether the structure is empty
 	bool operator!() const;
 
+	// writes the structure to a file, see serialization.h
+	// only available when T::arena_type is PermutationArena, whose contents are used in place after loading
+	void save( const std::string& path ) const;
+	void load( const std::string& path );
+
 	// constructs the structure
 	FHL();
 
@@ -88,37 +331,43 @@ public:
 template<typename T>
 void FHL<T>::clear() {
 	n = m = 0;
-	V.clear();
+	parallel = false;
+	V.reset( 0 );
+	A.reset( 0 );
 }
 
 template<typename T>
-void FHL<T>::create( std::vector<T> generators, size_t s ) {
+void FHL<T>::create( std::vector<T> generators, size_t s, bool par ) {
 	clear();
 	n = s;
 	m = n - 1;
+	parallel = par;
 	if( n > 0 ) {
-		V.resize( m );
-		for( size_t i = 0; i < m; ++i )
-			V[i].resize( n - i - 1, T( Permutation( 0 ) ) );
+		A.reset( n );
+		V.reset( m );
 		std::deque<T> new_permutations;
 		for( auto sigma : generators )
 			new_permutations.push_back( filter( sigma, true ) );
+		if( parallel ) {
+			closeParallel( new_permutations );
+			return;
+		}
+		T nu( Permutation( 0 ) );
+		T mu( Permutation( 0 ) );
 		while( not new_permutations.empty() ) {
 			T sigma = std::move( new_permutations.front() );
-			T mu( Permutation(0) );
 			new_permutations.pop_front();
-			for( const auto& W : V ) {
-				for( const auto& tau : W ) {
-					if( tau.degree() > 0 ) {
-						T nu = tau.inverse();
-						mu = filter( sigma * nu, true );
-						if( not mu.isIdentity() )
-							new_permutations.push_back( std::move( mu ) );
-						mu = filter( nu * sigma, true );
-						if( not mu.isIdentity() )
-							new_permutations.push_back( std::move( mu ) );
-					}
-				}
+			size_t i = 0;
+			for( int j = -1; V.next( i, j ); ) {
+				A[ V.get( i, j ) ].invertInto( nu );
+				T::composeInto( mu, sigma, nu );
+				sift( mu, true );
+				if( not mu.isIdentity() )
+					new_permutations.push_back( mu );
+				T::composeInto( mu, nu, sigma );
+				sift( mu, true );
+				if( not mu.isIdentity() )
+					new_permutations.push_back( mu );
 			}
 		}
 	}
@@ -126,21 +375,86 @@ void FHL<T>::create( std::vector<T> generators, size_t s ) {
 
 template<typename T>
 T FHL<T>::filter( T sigma, bool add ) const {
+	sift( sigma, add );
+	return sigma;
+	// returns (1) if found, incomplete filtrate otherwise
+}
+
+template<typename T>
+size_t FHL<T>::sift( T& sigma, bool add, size_t first ) const {
 	// Stabilise i
-	for( size_t i = 0; i < m; ++i ) {
-		size_t p = sigma( i );
-		if( p != i ) {
-			p -= i + 1;
-			if( V[i][p].degree() == 0 ) {
+	for( size_t i = first; i < m; ++i ) {
+		int j = sigma( i );
+		if( j != int( i ) ) {
+			int tau = V.get( i, j );
+			if( tau < 0 ) {
 				if( add )
-					V[i][p] = sigma.inverse();
-				break;
+					V.set( i, j, A.pushInverse( sigma ) );
+				return i;
 			} else
-				sigma = V[i][p] * sigma;
+				sigma.leftMultiplyInPlace( A[tau] );
+		}
+	}
+	return m;
+}
+
+template<typename T>
+std::vector<int> FHL<T>::cells() const {
+	std::vector<int> C;
+	C.reserve( V.size() );
+	for( size_t i = 0; i < V.rows(); ++i )
+		C.insert( C.end(), V.slots( i ).begin(), V.slots( i ).end() );
+	return C;
+}
+
+template<typename T>
+void FHL<T>::closeParallel( std::deque<T>& new_permutations ) {
+	// every batch multiplies some queued permutations with the cells present when the batch starts.
+	// the products are sifted without touching the table, concurrently. the residues are then
+	// committed serially in the order of the products: a residue whose cell is still empty is
+	// stored, one whose cell was filled by an earlier residue of the batch is sifted further.
+	// cells filled during a batch meet the batch through their own residues, which are queued.
+	typedef std::tuple<size_t,size_t,T> residue; // product, level, filtrate
+	std::vector<T> sigmas;
+	while( not new_permutations.empty() ) {
+		std::vector<int> C = cells();
+		sigmas.clear();
+		while( not new_permutations.empty() and sigmas.size() * 2 * C.size() < batch_size ) {
+			sigmas.push_back( std::move( new_permutations.front() ) );
+			new_permutations.pop_front();
+		}
+		// product k is sigmas[k/2C] * nu or nu * sigmas[k/2C] for nu the inverse of cell (k/2)%C
+		auto R = parallelRanges( sigmas.size() * 2 * C.size(), [&]( size_t begin, size_t end ) {
+			std::vector<residue> r;
+			T nu( Permutation( 0 ) );
+			T mu( Permutation( 0 ) );
+			for( size_t k = begin; k < end; ++k ) {
+				const T& sigma = sigmas[ k / ( 2 * C.size() ) ];
+				if( k == begin or k % 2 == 0 )
+					A[ C[ k / 2 % C.size() ] ].invertInto( nu );
+				if( k % 2 == 0 )
+					T::composeInto( mu, sigma, nu );
+				else
+					T::composeInto( mu, nu, sigma );
+				size_t i = sift( mu, false );
+				if( i < m )
+					r.emplace_back( k, i, mu );
+			}
+			return r;
+		} );
+		for( auto& part : R ) {
+			for( auto& x : part ) {
+				T& mu = std::get<2>( x );
+				size_t i = std::get<1>( x );
+				int j = mu( i );
+				if( V.get( i, j ) < 0 )
+					V.set( i, j, A.pushInverse( mu ) );
+				else if( sift( mu, true, i ) == m )
+					continue;
+				new_permutations.push_back( std::move( mu ) );
+			}
 		}
 	}
-	return sigma;
-	// returns (1) if found, incomplete filtrate otherwise
 }
 
 template<typename T>
@@ -166,39 +480,35 @@ FHL<T>::FHL() {
 template<typename T> 
 std::vector<T> FHL<T>::listGenerators() const {
 	std::vector<T> gens;
-	size_t i = 0;
-	for( const auto& X : V )
-		for( const auto& Y : X )
-			if( not Y.isIdentity() )
-				++i;
-	gens.reserve( i );
-	for( const auto& X : V )
-		for( const auto& Y : X )
-			if( not Y.isIdentity() )
-				gens.push_back( Y );
+	gens.reserve( A.size() );
+	for( int tau : cells() )
+		if( not A[tau].isIdentity() )
+			gens.emplace_back( A[tau] );
 	return gens;
 }
 
 template<typename T>
 bool FHL<T>::isGiant() const {
-	auto e = V.end() - 1;
-	for( auto b = V.begin(); b != e; ++b )
-		for( const T& sigma : *b )
-			if( sigma.degree() == 0 )
-				return false;
+	// every row but the last is full
+	for( size_t i = 0; i + 1 < V.rows(); ++i )
+		if( V.occupancy( i ) < n - i - 1 )
+			return false;
 	return true;
 }
 
 template<typename T>
 __int128_t FHL<T>::order() const {
 	__int128_t r = 1;
-	for( const auto& W : V ) {
-		__int128_t s = 1;
-		for( const auto& sigma : W )
-			if( sigma.degree() != 0 )
-				++s;
-		r *= s;
-	}
+	for( size_t i = 0; i < V.rows(); ++i )
+		r *= V.occupancy( i ) + 1;
+	return r;
+}
+
+template<typename T>
+natural FHL<T>::exactOrder() const {
+	natural r( 1 );
+	for( size_t i = 0; i < V.rows(); ++i )
+		r *= natural( V.occupancy( i ) + 1 );
 	return r;
 }
 
@@ -207,44 +517,337 @@ bool FHL<T>::operator!() const {
 	return n == 0;
 }
 
+template<typename T>
+void FHL<T>::save( const std::string& path ) const {
+	BinaryWriter out( path, StructureKind::fhl );
+	out.write<uint64_t>( n );
+	V.write( out );
+	out.write( A );
+	out.close();
+}
+
+template<typename T>
+void FHL<T>::load( const std::string& path ) {
+	BinaryReader in( path, StructureKind::fhl );
+	clear();
+	n = in.read<uint64_t>();
+	m = n > 0 ? n - 1 : 0;
+	V.read( in );
+	in.read( A );
+}
+
 template<typename T>
 std::ostream& operator<<( std::ostream& os, const FHL<T>& fhl ) {
-	return os << fhl.V;
+	std::vector<std::vector<T>> W;
+	for( size_t i = 0; i < fhl.V.rows(); ++i ) {
+		W.emplace_back();
+		for( size_t j = i + 1; j < fhl.n; ++j ) {
+			int tau = fhl.V.get( i, j );
+			W.back().push_back( tau < 0 ? T( Permutation( 0 ) ) : T( fhl.A[tau] ) );
+		}
+	}
+	return os << W;
 }
 
 #include "group.h"
 
-class PullbackStructure : public FHL<PermutationPullback> {
+// homomorphism from the group generated by originals to the pullback space, given on generators
+// *************************************************************
+// The table is built over the originals only, and records every
+// cell as a word in a straight-line program over the generators.
+// The program is compacted to these words once the table is
+// built, so it does not grow with later queries. A pullback is
+// evaluated when it is asked for: the cells an element sifts
+// through are evaluated with the pullbacks of the generators,
+// once each, and remembered for later queries. Only these cell
+// values are kept, and threads may share the structure.
+// Elements outside the group generated by the originals have no
+// pullback; the result is then unspecified.
+// The membership queries of FHL<WordPullback> record the words
+// of their products in the program, so they are hidden here by
+// versions that sift the originals only.
+// *************************************************************
+class PullbackStructure : public FHL<WordPullback> {
 	Group domain;
+	std::shared_ptr<StraightLineProgram> program;
+	std::vector<Permutation> images;          // pullbacks of the generators
+	mutable std::vector<Lazy<std::shared_ptr<const Permutation>>> values; // pullbacks of the cells by slot
+
+	void initialise( std::vector<Permutation> originals, std::vector<Permutation> pullbacks );
+
+	// sifts tau in place through the originals of the cells and returns the slots of the cells on its path, in order
+	std::vector<int> path( Permutation& tau ) const;
+
+	// evaluates the cells with the given slots that are still missing, in a single pass over the program
+	void evaluate( std::vector<int> slots ) const;
+
+	// returns the pullback of the sifted element with the given path, whose cells must be evaluated
+	Permutation pullback( const std::vector<int>& path ) const;
 public:
+	// returns the pullback of sigma
 	Permutation operator()( Permutation ) const;
+
+	// returns the pullbacks of all permutations in S, sifting them in one pass and evaluating shared cells once
+	std::vector<Permutation> operator()( const std::vector<Permutation>& S ) const;
+
+	// checks whether sigma is in the group generated by the originals
+	bool contains( const Permutation& sigma ) const;
+
+	// returns the residue of sigma after sifting, the identity when sigma is in the group generated by the originals
+	Permutation find( Permutation sigma ) const;
+
+	// returns the program holding the words of the cells
+	const StraightLineProgram& words() const;
+
 	PullbackStructure( Group pullback_space, const std::vector<PermutationPullback>& );
 	PullbackStructure( Group pullback_space, std::vector<Permutation> originals, std::vector<Permutation> pullbacks );
 };
 
 class SubgroupGenerator : public FHL<Permutation> {
+public:
+	// value that is constant on the left cosets of the subgroup, i.e. f( sigma * h ) = f( sigma ) for h in it
+	// e.g. the image of x for the stabiliser of x
+	typedef std::function<uint64_t(const Permutation&)> invariant_type;
+	typedef std::function<bool(const Permutation&)> predicate_type;
+private:
 	Group G;
-	mutable std::deque<Permutation> representatives;
-	std::function<bool(Permutation)> check;
+	mutable PermutationArena representatives;
+	mutable std::unordered_multimap<uint64_t,size_t> representative_index; // fingerprint to slot
+	mutable std::unordered_multimap<uint64_t,size_t> representative_buckets; // invariant of the coset to slot
+	predicate_type check; // copy of the predicate for queries after construction
+	invariant_type invariant; // null when the representatives are scanned linearly
 
+	// the closure is instantiated for the type of the predicate, so that it is called directly
 	Permutation filter( Permutation sigma, bool add ) const;
-	void subcreate();
+	template<typename P> Permutation filter( const P& predicate, Permutation sigma, bool add ) const;
+	// the table is first filled with the subgroup generated by known, which must be contained in the result
+	template<typename P> void subcreate( const P& predicate, const std::vector<Permutation>& generators, const std::vector<Permutation>& known );
+
+	// closure of subcreate in batches that are filtered concurrently, then committed in order
+	template<typename P> void subcloseParallel( const P& predicate, std::deque<Permutation>& new_permutations );
+
+	// clears the structure for a closure over H and returns the generators of H
+	std::vector<Permutation> prepare( Group H, bool parallel );
+
+	// returns the invariant of a predicate that has one, see predicates.h
+	template<typename P> static invariant_type invariantOf( const P& predicate, std::true_type );
+	template<typename P> static invariant_type invariantOf( const P& predicate, std::false_type );
+
+	// returns generators of the subgroup of H described by a predicate that computes it, none otherwise
+	template<typename P> static std::vector<Permutation> knownGenerators( Group H, const P& predicate, std::true_type );
+	template<typename P> static std::vector<Permutation> knownGenerators( Group H, const P& predicate, std::false_type );
 public:
 	// analog of FHL
+	// the predicate is anything callable as bool( const Permutation& ), e.g. a lambda or a predicate of predicates.h
+	// when it has a member invariant( sigma ), that is used as coset invariant
+	// when it has a member subgroupOf( H ), the table starts with that subgroup and the closure only finds coset representatives
+	// with parallel=true the predicate is called from several threads at once
 	void clear();
-	void create( Group H, std::function<bool(Permutation)> func );
-	void create( Group H, const FHL<Permutation>& P );
+	template<typename P, typename = typename std::enable_if<is_permutation_predicate<P>::value>::type>
+	void create( Group H, const P& predicate, bool parallel = false );
+	void create( Group H, const FHL<Permutation>& P, bool parallel = false );
+
+	// as create, with the coset invariant f of the subgroup
+	// a permutation is then only tested against the representatives with the same invariant
+	template<typename P, typename = typename std::enable_if<is_permutation_predicate<P>::value>::type>
+	void create( Group H, const P& predicate, invariant_type f, bool parallel = false );
 	bool contains( const Permutation& sigma ) const;
 	Permutation find( const Permutation& sigma ) const;
 	
 	// returns the subgroup defined by the check function
+	// its generators are reduced as set by StabilizerChain::defaults().reduction
 	Subgroup subgroup() const;
+	std::vector<Permutation> subgroupGenerators() const;
 
 	// returns all coset representatives of the quotient group
 	std::deque<Permutation> cosetRepresentatives() const;
 
 	// constructor
-	SubgroupGenerator( Group H, std::function<bool(Permutation)> func );
+	template<typename P, typename = typename std::enable_if<is_permutation_predicate<P>::value>::type>
+	SubgroupGenerator( Group H, const P& predicate );
+	template<typename P, typename = typename std::enable_if<is_permutation_predicate<P>::value>::type>
+	SubgroupGenerator( Group H, const P& predicate, invariant_type f );
 	SubgroupGenerator( const FHL<Permutation>& P );
 	SubgroupGenerator() = default;
-};
\ No newline at end of file
+};
+
+// --------------------------------------------------------------------------------------------------------------
+
+template<typename P>
+Permutation SubgroupGenerator::filter( const P& predicate, Permutation sigma, bool add ) const {
+	if( predicate( sigma ) )
+		return FHL<>::filter( sigma, add );
+	Permutation nu = sigma.inverse();
+	uint64_t h = nu.fingerprint();
+	auto range = representative_index.equal_range( h );
+	for( auto it = range.first; it != range.second; ++it )
+		if( kernels::equal( nu.width(), representatives[it->second].data(), PermutationRef( nu ).data(), nu.degree() ) )
+			return Permutation( sigma.degree() );
+	Permutation mu( 0 );
+	if( invariant ) {
+		// sigma is in the coset of representative p^-1 exactly when p * sigma is in the subgroup
+		uint64_t f = invariant( sigma );
+		auto bucket = representative_buckets.equal_range( f );
+		for( auto it = bucket.first; it != bucket.second; ++it ) {
+			Permutation::composeInto( mu, representatives[it->second], sigma );
+			if( predicate( mu ) )
+				return FHL<>::filter( std::move( mu ), add );
+		}
+		if( add ) {
+			size_t p = representatives.push( nu );
+			representative_index.emplace( h, p );
+			representative_buckets.emplace( f, p );
+		}
+		return sigma;
+	}
+	for( size_t p = 0; p < representatives.size(); ++p ) {
+		Permutation::composeInto( mu, representatives[p], sigma );
+		if( predicate( mu ) )
+			return FHL<>::filter( std::move( mu ), add );
+	}
+	if( add )
+		representative_index.emplace( h, representatives.push( nu ) );
+	return sigma;
+}
+
+template<typename P>
+void SubgroupGenerator::subcreate( const P& predicate, const std::vector<Permutation>& generators, const std::vector<Permutation>& known ) {
+	if( n > 0 ) {
+		// products of two elements of the known subgroup stay in it, so its cells need not be multiplied
+		// with each other under the predicate; every other pair is multiplied when its later element is queued
+		FHL<>::create( known, n, parallel );
+		representatives.reset( n );
+		std::deque<Permutation> new_permutations;
+		for( auto sigma : generators )
+			new_permutations.push_back( filter( predicate, sigma, true ) );
+		if( parallel ) {
+			subcloseParallel( predicate, new_permutations );
+			return;
+		}
+		Permutation nu( 0 );
+		Permutation mu( 0 );
+		while( not new_permutations.empty() ) {
+			Permutation sigma = std::move( new_permutations.front() );
+			new_permutations.pop_front();
+			size_t i = 0;
+			for( int j = -1; V.next( i, j ); ) {
+				A[ V.get( i, j ) ].invertInto( nu );
+				Permutation::composeInto( mu, sigma, nu );
+				mu = filter( predicate, std::move( mu ), true );
+				if( not mu.isIdentity() )
+					new_permutations.push_back( mu );
+				Permutation::composeInto( mu, nu, sigma );
+				mu = filter( predicate, std::move( mu ), true );
+				if( not mu.isIdentity() )
+					new_permutations.push_back( mu );
+			}
+			for( size_t p = 0; p < representatives.size(); ++p ) {
+				representatives[p].invertInto( nu );
+				Permutation::composeInto( mu, sigma, nu );
+				mu = filter( predicate, std::move( mu ), true );
+				if( not mu.isIdentity() )
+					new_permutations.push_back( mu );
+				Permutation::composeInto( mu, nu, sigma );
+				mu = filter( predicate, std::move( mu ), true );
+				if( not mu.isIdentity() )
+					new_permutations.push_back( mu );
+			}
+		}
+	}
+}
+
+template<typename P>
+void SubgroupGenerator::subcloseParallel( const P& predicate, std::deque<Permutation>& new_permutations ) {
+	// as FHL<T>::closeParallel, but the products are also taken with the coset representatives.
+	// a product that filters to the identity against the snapshot does so against any later
+	// state, since cells and representatives are only added; the others are filtered again
+	// serially, in order, with add=true
+	std::vector<Permutation> sigmas;
+	while( not new_permutations.empty() ) {
+		std::vector<int> C = cells();
+		size_t r = representatives.size();
+		size_t w = 2 * ( C.size() + r );
+		sigmas.clear();
+		while( not new_permutations.empty() and sigmas.size() * w < batch_size ) {
+			sigmas.push_back( std::move( new_permutations.front() ) );
+			new_permutations.pop_front();
+		}
+		// product k is sigmas[k/w] * nu or nu * sigmas[k/w] for nu the inverse of cell or representative (k%w)/2
+		auto product = [&]( size_t k, Permutation& nu, Permutation& mu ) {
+			size_t c = k % w / 2;
+			if( c < C.size() )
+				A[ C[c] ].invertInto( nu );
+			else
+				representatives[ c - C.size() ].invertInto( nu );
+			if( k % 2 == 0 )
+				Permutation::composeInto( mu, sigmas[ k / w ], nu );
+			else
+				Permutation::composeInto( mu, nu, sigmas[ k / w ] );
+		};
+		auto R = parallelRanges( sigmas.size() * w, [&]( size_t begin, size_t end ) {
+			std::vector<size_t> pending;
+			Permutation nu( 0 );
+			Permutation mu( 0 );
+			for( size_t k = begin; k < end; ++k ) {
+				product( k, nu, mu );
+				if( not filter( predicate, mu, false ).isIdentity() )
+					pending.push_back( k );
+			}
+			return pending;
+		} );
+		Permutation nu( 0 );
+		Permutation mu( 0 );
+		for( const auto& part : R ) {
+			for( size_t k : part ) {
+				product( k, nu, mu );
+				mu = filter( predicate, std::move( mu ), true );
+				if( not mu.isIdentity() )
+					new_permutations.push_back( mu );
+			}
+		}
+	}
+}
+
+template<typename P>
+SubgroupGenerator::invariant_type SubgroupGenerator::invariantOf( const P& predicate, std::true_type ) {
+	return [predicate]( const Permutation& sigma ) -> uint64_t { return predicate.invariant( sigma ); };
+}
+
+template<typename P>
+SubgroupGenerator::invariant_type SubgroupGenerator::invariantOf( const P&, std::false_type ) {
+	return nullptr;
+}
+
+template<typename P>
+std::vector<Permutation> SubgroupGenerator::knownGenerators( Group H, const P& predicate, std::true_type ) {
+	return predicate.subgroupOf( H )->generators();
+}
+
+template<typename P>
+std::vector<Permutation> SubgroupGenerator::knownGenerators( Group, const P&, std::false_type ) {
+	return {};
+}
+
+template<typename P, typename>
+void SubgroupGenerator::create( Group H, const P& predicate, bool par ) {
+	create( H, predicate, invariantOf( predicate, has_coset_invariant<P>() ), par );
+}
+
+template<typename P, typename>
+void SubgroupGenerator::create( Group H, const P& predicate, invariant_type f, bool par ) {
+	std::vector<Permutation> known = knownGenerators( H, predicate, has_structured_subgroup<P>() );
+	std::vector<Permutation> generators = prepare( H, par );
+	check = predicate;
+	invariant = f;
+	subcreate( predicate, generators, known );
+}
+
+template<typename P, typename>
+SubgroupGenerator::SubgroupGenerator( Group H, const P& predicate ) {
+	create( H, predicate );
+}
+
+template<typename P, typename>
+SubgroupGenerator::SubgroupGenerator( Group H, const P& predicate, invariant_type f ) {
+	create( H, predicate, f );
+}
@@ -2,11 +2,17 @@
 #include <vector>
 #include <cmath>
 #include <exception>
+#include <stdexcept>
+#include <random>
+#include <numeric>
 
 #include "group.h"
 #include "permutation.h"
 // #include "action.h"
 #include "fhl.h"
+#include "group_cache.h"
+#include "predicates.h"
+#include "backtrack.h"
 
 Permutation _Group::one() const {
 	int n = degree();
@@ -17,12 +23,24 @@ Permutation _Group::one() const {
 }
 
 bool _Group::hasSubgroup( Group H ) const {
-	for( const auto& gen : H->generators() )
-		if( !contains( gen ) )
+	return containsAll( H->generators() );
+}
+
+bool _Group::containsAll( const std::vector<Permutation>& P ) const {
+	for( const Permutation& sigma : P )
+		if( not contains( sigma ) )
 			return false;
 	return true;
 }
 
+std::vector<bool> _Group::containsMask( const std::vector<Permutation>& P ) const {
+	std::vector<bool> mask;
+	mask.reserve( P.size() );
+	for( const Permutation& sigma : P )
+		mask.push_back( contains( sigma ) );
+	return mask;
+}
+
 std::vector<int> _Group::domain() const {
 	std::vector<int> d( degree() );
 	for( int i = 0; i < degree(); i++ )
@@ -31,34 +49,251 @@ std::vector<int> _Group::domain() const {
 }
 
 Group _Group::stabilizer( int x ) const {
-	return Group( new Subgroup( share(), [x]( const Permutation& sigma ) { return sigma(x) == x; } ) );
+	return pointwiseStabilizer( { x } );
+}
+
+Group _Group::pointwiseStabilizer( const std::vector<int>& points ) const {
+	std::vector<int> prefix;
+	for( int x : points )
+		if( std::find( prefix.begin(), prefix.end(), x ) == prefix.end() )
+			prefix.push_back( x );
+	if( prefix.empty() )
+		return share();
+	auto C = chainWithBase( prefix, false );
+	return Group( new Subgroup( share(), std::make_shared<const StabilizerChain>( C->stabilizer( prefix.size() ) ), chainOptions() ) );
+}
+
+std::vector<Group> _Group::stabilizerChain( const std::vector<int>& base ) const {
+	auto C = chainWithBase( base, true );
+	std::vector<Group> R( 1, share() );
+	for( size_t i = 1; i <= base.size(); ++i )
+		R.emplace_back( new Subgroup( share(), std::make_shared<const StabilizerChain>( C->stabilizer( i ) ), chainOptions() ) );
+	return R;
+}
+
+Group _Group::rebased( const StabilizerChainOptions& options ) const {
+	StabilizerChainOptions strategy = chainOptions();
+	strategy.base_strategy = options.base_strategy;
+	strategy.base_order = options.base_order;
+	return Group( new Subgroup( share(), generators(), strategy ) );
+}
+
+const StabilizerChainOptions& _Group::chainOptions() const {
+	return StabilizerChain::defaults();
+}
+
+std::shared_ptr<const StabilizerChain> _Group::chainWithBase( const std::vector<int>& prefix, bool ) const {
+	return std::make_shared<const StabilizerChain>( generators(), degree(), prefix );
+}
+
+Group _Group::setStabilizer( const std::vector<int>& points ) const {
+	SetStabilizerProperty P( degree(), points );
+	return Group( new Subgroup( share(), BacktrackSearch( share(), P ).subgroup() ) );
+}
+
+Group _Group::intersection( Group H ) const {
+	CosetMembershipProperty P( H );
+	return Group( new Subgroup( share(), BacktrackSearch( share(), P ).subgroup() ) );
 }
 
 Group _Group::share() const {
 	return shared_from_this();
 }
 
+double _Group::giant_error = 1e-6;
+
+namespace {
+	bool isPrime( int p ) {
+		if( p < 2 )
+			return false;
+		for( int d = 2; d * d <= p; ++d )
+			if( p % d == 0 )
+				return false;
+		return true;
+	}
+}
+
+bool _Group::isGiant( double error ) const {
+	int n = degree();
+	// a cycle of prime length p with n/2 < p < n-2 in a transitive group forces a giant (Jordan).
+	// for p > n/2 exactly 1/p of the elements of S_n and of A_n contain a p-cycle, so every
+	// random element of a giant succeeds with probability q, the sum of 1/p over these primes
+	double q = 0;
+	for( int p = n / 2 + 1; p < n - 2; ++p )
+		if( isPrime( p ) )
+			q += 1. / p;
+	if( error <= 0 or q == 0 ) {
+		// there is no such prime for n < 8, the groups are small enough for the exact test
+		Group G( new Subgroup( share(), generators() ) );
+		return G->isGiant( 0 );
+	}
+	std::vector<Permutation> S = generators();
+	if( S.empty() )
+		return false;
+	// a giant is transitive
+	std::vector<bool> seen( n, false );
+	std::vector<int> orbit( 1, 0 );
+	seen[0] = true;
+	for( size_t k = 0; k < orbit.size(); ++k )
+		for( const Permutation& sigma : S )
+			if( not seen[ sigma( orbit[k] ) ] ) {
+				seen[ sigma( orbit[k] ) ] = true;
+				orbit.push_back( sigma( orbit[k] ) );
+			}
+	if( int( orbit.size() ) < n )
+		return false;
+	double tries = std::ceil( std::log( error ) / std::log1p( -q ) );
+	// the bound on the error needs independent random elements, so every call draws them from a fresh seed
+	static thread_local std::mt19937_64 seeds( std::random_device{}() );
+	ProductReplacement R( S, seeds() );
+	for( double t = 0; t < tries; ++t ) {
+		// at most one cycle is longer than n/2, and it comes first in the cycle type
+		int l = R.next().cycleType().front();
+		if( 2 * l > n and l < n - 2 and isPrime( l ) )
+			return true;
+	}
+	return false;
+}
+
+double _Group::log2Order() const {
+	return exactOrder().log2();
+}
+
+bool _Group::orderAtLeast( const natural& bound ) const {
+	return exactOrder() >= bound;
+}
+
 _Group::~_Group() {
 }
 
 // ----------------------------------------------------------------------------
 
 bool Subgroup::contains( const Permutation& alpha ) const {
-	if( !_fhl )
-		_fhl.create( generators(), degree() );
-	return _fhl.contains( alpha );
+	return chain().contains( alpha );
 }
 
-Subgroup::Subgroup( Group G, std::vector<Permutation> gens ) {
+bool Subgroup::containsAll( const std::vector<Permutation>& P ) const {
+	return chain().containsAll( P );
+}
+
+std::vector<bool> Subgroup::containsMask( const std::vector<Permutation>& P ) const {
+	return chain().containsMask( P );
+}
+
+Subgroup::Subgroup( Group G, std::vector<Permutation> gens ) : Subgroup( G, std::move( gens ), StabilizerChain::defaults() ) {
+}
+
+const StabilizerChain& Subgroup::chain() const {
+	return *_chain.get( [this]() { return buildChain( 0 ); } );
+}
+
+std::shared_ptr<const StabilizerChain> Subgroup::buildChain( const natural& bound ) const {
+	std::vector<Permutation> gens = generators();
+	GroupCache::Key key( gens, degree() );
+	std::shared_ptr<const StabilizerChain> cached = GroupCache::global().chain( key );
+	// an entry has these generators, but may come from a file, see load, so it must at least contain them
+	if( cached and cached->containsAll( gens ) ) {
+		_parent.reset();
+		if( _options.base_strategy == BaseStrategy::first_moved )
+			return cached;
+		// the cached chain may have been built with another base strategy
+		auto C = std::make_shared<StabilizerChain>( *cached );
+		C->changeBase( {}, _options );
+		return C;
+	}
+	StabilizerChainOptions options = _options;
+	options.bound = bound;
+	std::shared_ptr<StabilizerChain> C;
+	if( _parent ) {
+		// the chain of the parent may be shared, so extend a copy
+		C = std::make_shared<StabilizerChain>( _parent->chain() );
+		gens.erase( gens.begin(), gens.begin() + _inherited );
+		C->extend( gens, options );
+	} else {
+		C = std::make_shared<StabilizerChain>();
+		C->create( gens, degree(), {}, options );
+	}
+	// a chain that reached the bound may be incomplete, it is returned without being shared
+	if( not bound.isZero() and C->orderAtLeast( bound ) )
+		return C;
+	// the chain of a rebased group comes from its parent, whose base was chosen by another strategy
+	if( _parent and ( _parent->_options.base_strategy != _options.base_strategy or _parent->_options.base_order != _options.base_order ) )
+		C->changeBase( {}, _options );
+	// Monte Carlo chains may be incomplete and are not shared
+	if( _options.verify or not _options.randomized )
+		GroupCache::global().storeChain( key, C );
+	_parent.reset();
+	return C;
+}
+
+Subgroup::Subgroup( Group G, std::shared_ptr<const StabilizerChain> C, const StabilizerChainOptions& options ) : Subgroup( G, C->listGenerators(), options ) {
+	_chain.set( C );
+	// Monte Carlo chains may be incomplete and are not shared
+	if( _options.verify or not _options.randomized )
+		GroupCache::global().storeChain( GroupCache::Key( generators(), degree() ), C );
+}
+
+Group Subgroup::rebased( const StabilizerChainOptions& options ) const {
+	StabilizerChainOptions strategy = _options;
+	strategy.base_strategy = options.base_strategy;
+	strategy.base_order = options.base_order;
+	Subgroup* H = new Subgroup( supergroup(), generators(), strategy );
+	// the chain is copied from this group and its base changed when it is first needed
+	H->_parent = std::static_pointer_cast<const Subgroup>( share() );
+	H->_inherited = _generators.size();
+	return Group( H );
+}
+
+const StabilizerChainOptions& Subgroup::chainOptions() const {
+	return _options;
+}
+
+std::shared_ptr<const StabilizerChain> Subgroup::chainWithBase( const std::vector<int>& prefix, bool ordered ) const {
+	chain();
+	std::vector<int> B = _chain.value()->base();
+	if( B.size() >= prefix.size() ) {
+		if( ordered ? std::equal( prefix.begin(), prefix.end(), B.begin() ) : std::is_permutation( prefix.begin(), prefix.end(), B.begin() ) )
+			return _chain.value();
+	}
+	auto C = std::make_shared<StabilizerChain>( chain() );
+	C->changeBase( prefix );
+	return C;
+}
+
+Subgroup::Subgroup( Group G, std::vector<Permutation> gens, const StabilizerChainOptions& options ) : _generators( G->degree() ), _options( options ), _inherited( 0 ) {
 	swap( _supergroup, G );
-	swap( _generators, gens );
+	_generators.reserve( gens.size() );
+	for( const Permutation& sigma : gens )
+		_generators.push( sigma );
 }
 
-Subgroup::Subgroup( Group G, std::function<bool(Permutation)> c ) : Subgroup( SubgroupGenerator( G, c ).subgroup() ) {
+void Subgroup::save( const std::string& path ) const {
+	BinaryWriter out( path, StructureKind::subgroup );
+	out.write( _generators );
+	chain().write( out );
+	out.close();
+}
+
+Group Subgroup::load( const std::string& path, Group G ) {
+	BinaryReader in( path, StructureKind::subgroup );
+	PermutationArena generators;
+	in.read( generators );
+	if( generators.degree() != G->degree() )
+		throw std::range_error( "Stored subgroup has a different degree" );
+	std::vector<Permutation> gens;
+	gens.reserve( generators.size() );
+	for( size_t i = 0; i < generators.size(); ++i )
+		gens.emplace_back( generators[i] );
+	auto C = std::make_shared<StabilizerChain>();
+	C->read( in );
+	Subgroup* H = new Subgroup( G, gens );
+	H->_chain.set( C );
+	GroupCache::global().storeChain( GroupCache::Key( gens, G->degree() ), C );
+	return Group( H );
 }
 
 std::vector<Coset> _Group::allCosets( Group N ) const {
-	SubgroupGenerator sg( share(), [&]( const Permutation& p ) -> bool { return N->contains( p ); } );
+	SubgroupGenerator sg( share(), MembershipPredicate( N ) );
 
 	const auto& R = sg.cosetRepresentatives();
 	std::vector<Coset> cs;
@@ -69,10 +304,11 @@ std::vector<Coset> _Group::allCosets( Group N ) const {
 	return cs;
 }
 
-bool Subgroup::isGiant() const {
-	if( not _fhl )
-		_fhl.create( generators(), degree() );
-	return _fhl.isGiant();
+bool Subgroup::isGiant( double error ) const {
+	// a chain that is already there answers exactly
+	if( error <= 0 or _chain.ready() )
+		return chain().isGiant();
+	return _Group::isGiant( error );
 }
 
 Subgroup::~Subgroup() {
@@ -83,7 +319,11 @@ Group Subgroup::supergroup() const {
 }
 
 std::vector<Permutation> Subgroup::generators() const {
-	return _generators;
+	std::vector<Permutation> gens;
+	gens.reserve( _generators.size() );
+	for( size_t i = 0; i < _generators.size(); ++i )
+		gens.emplace_back( _generators[i] );
+	return gens;
 }
 
 int Subgroup::degree() const {
@@ -91,18 +331,39 @@ int Subgroup::degree() const {
 }
 
 __int128_t Subgroup::order() const {
-	if( !_fhl )
-		_fhl.create( generators(), degree() );
-	return _fhl.order();
+	return chain().order();
+}
+
+natural Subgroup::exactOrder() const {
+	return chain().exactOrder();
+}
+
+double Subgroup::log2Order() const {
+	return chain().log2Order();
+}
+
+bool Subgroup::orderAtLeast( const natural& bound ) const {
+	// a chain that stopped early at the bound is not kept
+	auto C = _chain.get( [&]() { return buildChain( bound ); }, [&]( const std::shared_ptr<const StabilizerChain>& C ) {
+		return bound.isZero() or not C->orderAtLeast( bound );
+	} );
+	return C->orderAtLeast( bound );
 }
 
 Group Subgroup::join( std::deque<Permutation>&& P ) const {
-	std::vector<Permutation> new_generators;
-	new_generators.reserve( generators().size() + P.size() );
-	new_generators.insert( new_generators.end(), _generators.cbegin(), _generators.cend() );
+	std::vector<Permutation> new_generators = generators();
+	size_t old = new_generators.size();
+	new_generators.reserve( old + P.size() );
+	PermutationSet known( new_generators.cbegin(), new_generators.cend() );
 	for( int i = P.size() - 1; i >= 0; --i )
-		new_generators.push_back( std::move( P[i] ) );
-	return Group( new Subgroup( supergroup(), new_generators ) );
+		if( not P[i].isIdentity() and known.insert( P[i] ).second )
+			new_generators.push_back( std::move( P[i] ) );
+	StabilizerChainOptions options = _options;
+	options.order = 0;
+	Subgroup* H = new Subgroup( supergroup(), new_generators, options );
+	H->_parent = std::static_pointer_cast<const Subgroup>( share() );
+	H->_inherited = old;
+	return Group( H );
 }
 
 // ----------------------------------------------------------------------------
@@ -116,7 +377,15 @@ int SymmetricGroup::degree() const {
 }
 
 __int128_t SymmetricGroup::order() const {
-	return std::tgamma( _degree + 1 ) + .9;
+	return __int128_t( exactOrder() );
+}
+
+natural SymmetricGroup::exactOrder() const {
+	return factorial( _degree );
+}
+
+double SymmetricGroup::log2Order() const {
+	return std::lgamma( _degree + 1 ) / std::log( 2. );
 }
 
 Group SymmetricGroup::join( std::deque<Permutation>&& P ) const {
@@ -141,6 +410,29 @@ std::vector<Permutation> SymmetricGroup::generators() const {
 	return std::vector<Permutation>({ sigma, tau });
 }
 
+std::shared_ptr<const StabilizerChain> SymmetricGroup::chainWithBase( const std::vector<int>& prefix, bool ) const {
+	std::vector<int> base( prefix );
+	std::vector<bool> used( _degree, false );
+	for( int b : prefix )
+		used[b] = true;
+	for( int x = 0; x < _degree; ++x )
+		if( not used[x] )
+			base.push_back( x );
+	// the stabiliser of b_0,...,b_{i-1} is generated by the transpositions (b_j b_{j+1}) with j >= i, so the
+	// chain reaches n! from the orbits alone, and the bound stops it before any Schreier generator is sifted
+	std::vector<Permutation> S;
+	S.reserve( base.size() );
+	std::vector<int> images( _degree );
+	for( size_t i = 0; i + 1 < base.size(); ++i ) {
+		std::iota( images.begin(), images.end(), 0 );
+		std::swap( images[ base[i] ], images[ base[i + 1] ] );
+		S.emplace_back( std::vector<int>( images ) );
+	}
+	StabilizerChainOptions options = chainOptions();
+	options.bound = exactOrder();
+	return std::make_shared<const StabilizerChain>( S, _degree, base, options );
+}
+
 SymmetricGroup::SymmetricGroup( int n ) {
 	_degree = n;
 }
@@ -148,6 +440,6 @@ SymmetricGroup::SymmetricGroup( int n ) {
 SymmetricGroup::~SymmetricGroup() {
 }
 
-bool SymmetricGroup::isGiant() const {
+bool SymmetricGroup::isGiant( double ) const {
 	return true;
 }
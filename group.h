@@ -5,6 +5,8 @@
 #include <memory>
 #include <set>
 #include <deque>
+#include <algorithm>
+#include <functional>
 
 class _Group;
 class Subgroup;
@@ -13,17 +15,32 @@ typedef std::shared_ptr<const _Group> Group;
 #include "permutation.h"
 #include "coset.h"
 #include "fhl.h"
+#include "stabilizer_chain.h"
+#include "multi.h"
 
 class _Group: public std::enable_shared_from_this<const _Group> {
 public:
 	// checks whether the group contains the given permutation
 	virtual bool contains( const Permutation& ) const = 0;
 
+	// checks whether the group contains all, respectively which, of the given permutations
+	// groups with a membership structure test them together, see StabilizerChain::containsAll
+	virtual bool containsAll( const std::vector<Permutation>& ) const;
+	virtual std::vector<bool> containsMask( const std::vector<Permutation>& ) const;
+
 	// computes the degree of the group
 	virtual int degree() const = 0;
 
 	// computes the order of the group
+	// order() saturates when the order does not fit, exactOrder() does not
 	virtual __int128_t order() const = 0;
+	virtual natural exactOrder() const = 0;
+
+	// returns the binary logarithm of the order
+	virtual double log2Order() const;
+
+	// checks whether the order is at least bound, possibly without computing it
+	virtual bool orderAtLeast( const natural& bound ) const;
 
 	// returns a copy of a list of generators for the group
 	virtual std::vector<Permutation> generators() const = 0;
@@ -31,8 +48,15 @@ public:
 	// returns the group generated by this group and the generators
 	virtual Group join( std::deque<Permutation>&& ) const = 0;
 
+	// probability with which isGiant may miss a giant when no error is given
+	static double giant_error;
+
 	// checks whether the group is the complete alternating or symmetric group
-	virtual bool isGiant() const = 0;
+	// by default this is a Monte Carlo test: a non-giant is never reported as giant, and a giant
+	// is missed with probability at most error. every call uses new random elements, so repeated
+	// calls miss a giant independently. with error=0 the deterministic test is used, which builds
+	// the membership structure of the group
+	virtual bool isGiant( double error = giant_error ) const;
 
 	// returns a shared pointer to this group
 	Group share() const;
@@ -43,6 +67,32 @@ public:
 	// returns the point-wise stabiliser of x 
 	Group stabilizer( int x ) const;
 
+	// returns the pointwise stabiliser of a set of points
+	// it is read off a stabilizer chain whose base starts with the points, the base is changed when needed
+	Group pointwiseStabilizer( const std::vector<int>& points ) const;
+
+	// returns the groups G_0 >= G_1 >= ... >= G_k with G_0 this group and G_i the pointwise stabiliser of base[0],...,base[i-1]
+	// the points of base must be distinct
+	// every G_i shares the levels of one stabilizer chain
+	std::vector<Group> stabilizerChain( const std::vector<int>& base ) const;
+
+	// returns a stabilizer chain of the group whose base starts with the points of prefix, in that order if ordered
+	// the default builds one from the generators on every call, subgroups and symmetric groups reuse or construct it cheaply
+	virtual std::shared_ptr<const StabilizerChain> chainWithBase( const std::vector<int>& prefix, bool ordered ) const;
+
+	// returns the options with which the stabilizer chains of the group are built
+	virtual const StabilizerChainOptions& chainOptions() const;
+
+	// returns the group as subgroup of the same group, with a stabilizer chain whose base points follow the base strategy of options
+	// nothing is computed until the chain is needed; a subgroup then changes the base of a copy of its own chain, see StabilizerChain::changeBase
+	virtual Group rebased( const StabilizerChainOptions& options ) const;
+
+	// returns the setwise stabiliser of a set of points, by backtrack search
+	Group setStabilizer( const std::vector<int>& points ) const;
+
+	// returns the intersection of the group with H, by backtrack search
+	Group intersection( Group H ) const;
+
 	// checks whether the group has H as subgroup
 	bool hasSubgroup( Group H ) const;
 
@@ -61,25 +111,66 @@ public:
 
 class Subgroup: public _Group {
 	Group _supergroup;
-	std::vector<Permutation> _generators;
-	mutable FHL<Permutation> _fhl;
+	PermutationArena _generators;
+	StabilizerChainOptions _options;
+	Lazy<std::shared_ptr<const StabilizerChain>> _chain; // possibly shared with equal groups through the GroupCache
+	mutable std::shared_ptr<const Subgroup> _parent; // group this one was joined or rebased from, until the chain is built
+	size_t _inherited;                               // number of leading generators taken from _parent
+
+	// returns the stabilizer chain, building it on first use
+	// a joined group extends a copy of the chain of its parent by the new generators only
+	// the group may be shared between threads, which then build the chain once
+	const StabilizerChain& chain() const;
+
+	// builds the stabilizer chain, stopping early once the order is known to be at least bound
+	// only called while _chain is locked, which also guards _parent
+	std::shared_ptr<const StabilizerChain> buildChain( const natural& bound ) const;
 public:
 	// returns a shared reference to the group this group is a subgroup of
 	Group supergroup() const;
 
 	virtual bool contains( const Permutation& ) const;
+	virtual bool containsAll( const std::vector<Permutation>& ) const;
+	virtual std::vector<bool> containsMask( const std::vector<Permutation>& ) const;
 	virtual int degree() const;
 	virtual __int128_t order() const;
+	virtual natural exactOrder() const;
+	virtual double log2Order() const;
+	virtual bool orderAtLeast( const natural& bound ) const;
 	virtual std::vector<Permutation> generators() const;
 	virtual Group join( std::deque<Permutation>&& ) const;
-	virtual bool isGiant() const;
+	virtual bool isGiant( double error = giant_error ) const;
+	virtual std::shared_ptr<const StabilizerChain> chainWithBase( const std::vector<int>& prefix, bool ordered ) const;
+	virtual const StabilizerChainOptions& chainOptions() const;
+	virtual Group rebased( const StabilizerChainOptions& options ) const;
 
 	// construct a subgroup generated by permutations S of G
 	Subgroup( Group G, std::vector<Permutation> S );
 
+	// construct the subgroup of G encoded by a stabilizer chain, generated by its strong generators
+	// the options are those the chain was built with; it is put in the GroupCache unless they make it a Monte Carlo chain
+	Subgroup( Group G, std::shared_ptr<const StabilizerChain> chain, const StabilizerChainOptions& options = StabilizerChain::defaults() );
+
+	// construct a subgroup generated by permutations S of G, whose stabilizer chain is built with the given options
+	// e.g. a randomized build, or a known order
+	Subgroup( Group G, std::vector<Permutation> S, const StabilizerChainOptions& options );
+
 	// construct a subgroup containing all permutations of G for which f returns true
+	// f is anything callable as bool( const Permutation& ), e.g. a lambda or a predicate of predicates.h
 	// WARNING: it is undefined behaviour when f does not describe a group
-	Subgroup( Group G, std::function<bool(Permutation)> f );
+	template<typename P, typename = typename std::enable_if<is_permutation_predicate<P>::value>::type>
+	Subgroup( Group G, const P& f );
+
+	// as above, with a value that is constant on the left cosets of the subgroup, see SubgroupGenerator
+	template<typename P, typename = typename std::enable_if<is_permutation_predicate<P>::value>::type>
+	Subgroup( Group G, const P& f, std::function<uint64_t(const Permutation&)> invariant );
+
+	// writes the generators and the stabilizer chain to a file, see serialization.h
+	void save( const std::string& path ) const;
+
+	// reads a subgroup of G written by save
+	// its stabilizer chain is put in the GroupCache, so every group with these generators uses the stored chain
+	static Group load( const std::string& path, Group G );
 
 	virtual ~Subgroup();
 };
@@ -90,12 +181,53 @@ public:
 	virtual bool contains( const Permutation& ) const;
 	virtual int degree() const;
 	virtual __int128_t order() const;
+	virtual natural exactOrder() const;
+	virtual double log2Order() const;
 	virtual std::vector<Permutation> generators() const;
 	virtual Group join( std::deque<Permutation>&& ) const;
-	virtual bool isGiant() const;
+	virtual bool isGiant( double error = giant_error ) const;
+
+	// returns the chain whose strong generators are the transpositions of consecutive base points, which is complete as it stands
+	// the base is prefix followed by the other points in increasing order
+	virtual std::shared_ptr<const StabilizerChain> chainWithBase( const std::vector<int>& prefix, bool ordered ) const;
 
 	// construct a symmetric group on the elements {0,...,n-1}
 	SymmetricGroup( int n );
 	
 	virtual ~SymmetricGroup();
 };
+
+// ----------------------------------------------------------------
+
+// returns generators of the subgroup of G described by a predicate that computes it, see predicates.h
+template<typename Generator, typename P, typename... Invariant>
+std::vector<Permutation> predicateGenerators( std::true_type, Group G, const P& f, Invariant&&... ) {
+	return f.subgroupOf( G )->generators();
+}
+
+// returns generators of the subgroup of G of the permutations satisfying f, by the closure of Generator
+template<typename Generator, typename P, typename... Invariant>
+std::vector<Permutation> predicateGenerators( std::false_type, Group G, const P& f, Invariant&&... invariant ) {
+	return Generator( G, f, std::forward<Invariant>( invariant )... ).subgroupGenerators();
+}
+
+// returns generators of the subgroup of G of the permutations satisfying f, see SubgroupGenerator
+// a predicate with a member subgroupOf( G ), see predicates.h, computes the subgroup without the closure
+// Generator is SubgroupGenerator; it is a parameter so that its definition is only needed where this is used
+template<typename Generator = SubgroupGenerator, typename P, typename... Invariant>
+std::vector<Permutation> predicateGenerators( Group G, const P& f, Invariant&&... invariant ) {
+	// f describes a group, so when it holds on the generators of G it holds on G
+	std::vector<Permutation> S = G->generators();
+	if( std::all_of( S.begin(), S.end(), [&f]( const Permutation& sigma ) -> bool { return f( sigma ); } ) )
+		return S;
+	return predicateGenerators<Generator>( has_structured_subgroup<P>(), G, f, std::forward<Invariant>( invariant )... );
+}
+
+template<typename P, typename>
+Subgroup::Subgroup( Group G, const P& f ) : Subgroup( G, predicateGenerators( G, f ) ) {
+}
+
+template<typename P, typename>
+Subgroup::Subgroup( Group G, const P& f, std::function<uint64_t(const Permutation&)> invariant ) : Subgroup( G, predicateGenerators( G, f, std::move( invariant ) ) ) {
+}
+
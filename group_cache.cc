@@ -0,0 +1,118 @@
+#include <algorithm>
+
+#include "group_cache.h"
+
+GroupCache::Key::Key( const std::vector<Permutation>& S, int n ) : degree( n ) {
+	generators.reserve( S.size() );
+	for( const Permutation& sigma : S )
+		if( not sigma.isIdentity() )
+			generators.push_back( sigma );
+	std::sort( generators.begin(), generators.end(), []( const Permutation& a, const Permutation& b ) {
+		return a.fingerprint() != b.fingerprint() ? a.fingerprint() < b.fingerprint() : a < b;
+	} );
+	generators.erase( std::unique( generators.begin(), generators.end() ), generators.end() );
+	hash = std::hash<int>()( n );
+	for( const Permutation& sigma : generators )
+		hash = ( hash ^ sigma.fingerprint() ) * 0x100000001b3ULL + ( hash >> 29 );
+}
+
+bool GroupCache::Key::operator==( const Key& other ) const {
+	return hash == other.hash and degree == other.degree and generators == other.generators;
+}
+
+size_t GroupCache::hasher::operator()( const Key& key ) const {
+	return key.hash;
+}
+
+GroupCache::entry* GroupCache::touch( const Key& key ) {
+	auto it = _table.find( key );
+	if( it == _table.end() ) {
+		++_misses;
+		return nullptr;
+	}
+	++_hits;
+	_recency.splice( _recency.begin(), _recency, it->second.position );
+	return &it->second;
+}
+
+GroupCache::entry& GroupCache::insert( const Key& key ) {
+	auto r = _table.emplace( key, entry() );
+	entry& e = r.first->second;
+	if( r.second ) {
+		_recency.push_front( &r.first->first );
+		e.position = _recency.begin();
+		while( _table.size() > _capacity ) {
+			_table.erase( _table.find( *_recency.back() ) );
+			_recency.pop_back();
+		}
+	} else
+		_recency.splice( _recency.begin(), _recency, e.position );
+	return e;
+}
+
+GroupCache& GroupCache::global() {
+	static GroupCache cache;
+	return cache;
+}
+
+GroupCache::chain_type GroupCache::chain( const Key& key ) {
+	std::lock_guard<std::mutex> guard( _lock );
+	entry* e = touch( key );
+	return e ? e->chain : nullptr;
+}
+
+void GroupCache::storeChain( const Key& key, chain_type chain ) {
+	std::lock_guard<std::mutex> guard( _lock );
+	if( _capacity > 0 )
+		insert( key ).chain = std::move( chain );
+}
+
+GroupCache::orbits_type GroupCache::orbits( const Key& key ) {
+	std::lock_guard<std::mutex> guard( _lock );
+	entry* e = touch( key );
+	return e ? e->orbits : nullptr;
+}
+
+void GroupCache::storeOrbits( const Key& key, orbits_type orbits ) {
+	std::lock_guard<std::mutex> guard( _lock );
+	if( _capacity > 0 )
+		insert( key ).orbits = std::move( orbits );
+}
+
+size_t GroupCache::size() const {
+	std::lock_guard<std::mutex> guard( _lock );
+	return _table.size();
+}
+
+size_t GroupCache::capacity() const {
+	std::lock_guard<std::mutex> guard( _lock );
+	return _capacity;
+}
+
+void GroupCache::setCapacity( size_t capacity ) {
+	std::lock_guard<std::mutex> guard( _lock );
+	_capacity = capacity;
+	while( _table.size() > _capacity ) {
+		_table.erase( _table.find( *_recency.back() ) );
+		_recency.pop_back();
+	}
+}
+
+size_t GroupCache::hits() const {
+	std::lock_guard<std::mutex> guard( _lock );
+	return _hits;
+}
+
+size_t GroupCache::misses() const {
+	std::lock_guard<std::mutex> guard( _lock );
+	return _misses;
+}
+
+void GroupCache::clear() {
+	std::lock_guard<std::mutex> guard( _lock );
+	_table.clear();
+	_recency.clear();
+}
+
+GroupCache::GroupCache( size_t capacity ) : _capacity( capacity ), _hits( 0 ), _misses( 0 ) {
+}
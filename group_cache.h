@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+
+#include "permutation.h"
+#include "stabilizer_chain.h"
+
+// process-wide cache of the structures computed for a generating set
+// *************************************************************
+// Entries are keyed by the degree and the set of generators,
+// so neither the order nor repetitions of the generators matter.
+// Keys are hashed by the fingerprints of the generators, but
+// compared by the generators themselves, so permutations whose
+// fingerprints collide never share an entry. At most capacity() entries are kept, the
+// least recently used one is evicted first. Cached structures are
+// immutable and handed out as shared pointers: a group that wants
+// to change one, e.g. to extend it, copies it first.
+// All members are thread-safe.
+// *************************************************************
+class GroupCache {
+public:
+	// canonical description of a generating set
+	struct Key {
+		int degree;
+		std::vector<Permutation> generators; // ordered by fingerprint, without duplicates and identities
+		uint64_t hash;
+		bool operator==( const Key& ) const;
+		Key( const std::vector<Permutation>& S, int degree );
+	};
+
+	typedef std::shared_ptr<const StabilizerChain> chain_type;
+	typedef std::shared_ptr<const std::vector<std::vector<int>>> orbits_type;
+private:
+	struct hasher {
+		size_t operator()( const Key& key ) const;
+	};
+	struct entry {
+		chain_type chain;
+		orbits_type orbits;
+		std::list<const Key*>::iterator position;
+	};
+	mutable std::mutex _lock;
+	std::unordered_map<Key,entry,hasher> _table;
+	std::list<const Key*> _recency; // most recently used first
+	size_t _capacity;
+	size_t _hits, _misses;
+
+	// returns the entry of key and marks it as most recently used, nullptr when absent
+	entry* touch( const Key& key );
+
+	// returns the entry of key, inserting it and evicting old entries when needed
+	entry& insert( const Key& key );
+public:
+	// returns the cache shared by all groups
+	static GroupCache& global();
+
+	// returns the cached stabilizer chain, nullptr when absent
+	chain_type chain( const Key& key );
+	void storeChain( const Key& key, chain_type chain );
+
+	// returns the cached orbits of the natural action, nullptr when absent
+	orbits_type orbits( const Key& key );
+	void storeOrbits( const Key& key, orbits_type orbits );
+
+	// returns the number of entries
+	size_t size() const;
+
+	// sets the maximum number of entries, 0 disables the cache
+	size_t capacity() const;
+	void setCapacity( size_t capacity );
+
+	// returns the number of successful and failed lookups
+	size_t hits() const;
+	size_t misses() const;
+
+	// removes all entries
+	void clear();
+
+	GroupCache( size_t capacity = 256 );
+};
@@ -54,8 +54,14 @@ Iso StringIsomorphismNonAutomorphism( Group G, string x, string y ) {
 		return ChainRule( G, x, y, Delta, StringIsomorphism );
 }
 
-double cameron_bound( double m ) {
-	return std::exp2( 7 * std::log2(m) * std::log2(m) * std::log2(std::log2(m)) );
+natural cameron_bound( int m ) {
+	// 2^(7 log^2(m) loglog(m)) does not fit in a double for m beyond a few hundred
+	double e = m > 2 ? 7 * std::log2(m) * std::log2(m) * std::log2(std::log2(m)) : 0;
+	if( e < 63 )
+		return natural( std::ceil( std::exp2( e ) ) );
+	// keep the 53 significant bits of a double
+	int k = int( e ) - 52;
+	return natural( std::exp2( e - k ) ) * powerOfTwo( k );
 }
 
 // computes the G-isomorphisms from x to y if G is transitive
@@ -69,7 +75,7 @@ Iso StringIsomorphismTransitive( Group G, string x, string y ) {
 	auto B = A.domain();
 	int m = B.size();
 	auto H = A.anonymize();
-	if( H->degree() <= 24 or H->order() < cameron_bound( m ) ) { 
+	if( H->degree() <= 24 or not H->orderAtLeast( cameron_bound( m ) ) ) { 
 		auto N = A.kernel();
 		return WeakReduction( G, N, x, y, StringIsomorphism );
 	} else {
@@ -78,11 +78,12 @@ Iso ChainRule( Group G, string x, string y, std::vector<std::vector<int>> orbits
 		if( I.isEmpty() )
 			return Empty();
 		PullbackStructure P( F, perm, F->generators() );
-		auto tau = P( I.coset().representative() );
 		auto perm2 = I.coset().subgroup()->generators();
-		std::deque<Permutation> perm3;
-		for( auto& sigma : perm2 )
-			perm3.push_back( P( sigma ) );
+		perm2.push_back( I.coset().representative() );
+		auto pullbacks = P( perm2 );
+		auto tau = std::move( pullbacks.back() );
+		pullbacks.pop_back();
+		std::deque<Permutation> perm3( std::make_move_iterator( pullbacks.begin() ), std::make_move_iterator( pullbacks.end() ) );
 		RestrictedNaturalAction A( F, almostDelta );
 		Group J = A.kernel();
 
@@ -92,6 +93,14 @@ Iso ChainRule( Group G, string x, string y, std::vector<std::vector<int>> orbits
 		mu = mu * tau;
 	}
 
+	// base the membership structure of the result on the orbits, in the order they were handled
+	// when it is needed, the chain F extends from the earlier steps is rebased, not rebuilt
+	StabilizerChainOptions options;
+	options.base_strategy = BaseStrategy::given_order;
+	for( const auto& Delta : orbits )
+		options.base_order.insert( options.base_order.end(), Delta.begin(), Delta.end() );
+	F = F->rebased( options );
+
 	// return result
 	Coset R( G, F, mu, false );
 	return R; 
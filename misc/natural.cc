@@ -0,0 +1,156 @@
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "natural.h"
+
+void natural::trim() {
+	while( not limbs.empty() and limbs.back() == 0 )
+		limbs.pop_back();
+}
+
+bool natural::isZero() const {
+	return limbs.empty();
+}
+
+natural& natural::operator+=( const natural& other ) {
+	if( limbs.size() < other.limbs.size() )
+		limbs.resize( other.limbs.size(), 0 );
+	uint64_t carry = 0;
+	for( size_t i = 0; i < limbs.size(); ++i ) {
+		carry += uint64_t( limbs[i] ) + ( i < other.limbs.size() ? other.limbs[i] : 0 );
+		limbs[i] = uint32_t( carry );
+		carry >>= 32;
+		if( carry == 0 and i >= other.limbs.size() )
+			break;
+	}
+	if( carry )
+		limbs.push_back( uint32_t( carry ) );
+	return *this;
+}
+
+natural& natural::operator*=( const natural& other ) {
+	return *this = (*this) * other;
+}
+
+natural natural::operator+( const natural& other ) const {
+	natural r = *this;
+	return r += other;
+}
+
+natural natural::operator*( const natural& other ) const {
+	natural r;
+	if( isZero() or other.isZero() )
+		return r;
+	r.limbs.assign( limbs.size() + other.limbs.size(), 0 );
+	for( size_t i = 0; i < limbs.size(); ++i ) {
+		uint64_t carry = 0;
+		for( size_t j = 0; j < other.limbs.size(); ++j ) {
+			carry += uint64_t( limbs[i] ) * other.limbs[j] + r.limbs[i+j];
+			r.limbs[i+j] = uint32_t( carry );
+			carry >>= 32;
+		}
+		r.limbs[i + other.limbs.size()] = uint32_t( carry );
+	}
+	r.trim();
+	return r;
+}
+
+bool natural::operator<( const natural& other ) const {
+	if( limbs.size() != other.limbs.size() )
+		return limbs.size() < other.limbs.size();
+	return std::lexicographical_compare( limbs.rbegin(), limbs.rend(), other.limbs.rbegin(), other.limbs.rend() );
+}
+
+bool natural::operator<=( const natural& other ) const {
+	return not( other < *this );
+}
+
+bool natural::operator>( const natural& other ) const {
+	return other < *this;
+}
+
+bool natural::operator>=( const natural& other ) const {
+	return not( *this < other );
+}
+
+bool natural::operator==( const natural& other ) const {
+	return limbs == other.limbs;
+}
+
+bool natural::operator!=( const natural& other ) const {
+	return limbs != other.limbs;
+}
+
+double natural::log2() const {
+	if( isZero() )
+		return -std::numeric_limits<double>::infinity();
+	// the top two limbs determine the mantissa
+	size_t k = limbs.size();
+	double top = limbs[k-1];
+	if( k > 1 )
+		top = top * 4294967296. + limbs[k-2];
+	return std::log2( top ) + 32. * ( k > 1 ? k - 2 : 0 );
+}
+
+std::string natural::toString() const {
+	if( isZero() )
+		return "0";
+	std::vector<uint32_t> q = limbs;
+	std::string s;
+	while( not q.empty() ) {
+		// divide by 10^9 and emit the remainder
+		uint64_t r = 0;
+		for( size_t i = q.size(); i-- > 0; ) {
+			r = ( r << 32 ) | q[i];
+			q[i] = uint32_t( r / 1000000000 );
+			r %= 1000000000;
+		}
+		while( not q.empty() and q.back() == 0 )
+			q.pop_back();
+		for( int j = 0; j < 9; ++j ) {
+			s.push_back( '0' + r % 10 );
+			r /= 10;
+			if( q.empty() and r == 0 )
+				break;
+		}
+	}
+	std::reverse( s.begin(), s.end() );
+	return s;
+}
+
+natural::operator __int128_t() const {
+	if( limbs.size() > 4 or ( limbs.size() == 4 and limbs[3] >> 31 ) )
+		return ~( __int128_t( 1 ) << 127 );
+	__int128_t r = 0;
+	for( size_t i = limbs.size(); i-- > 0; )
+		r = ( r << 32 ) | limbs[i];
+	return r;
+}
+
+natural::operator double() const {
+	return std::exp2( log2() );
+}
+
+natural::natural( uint64_t n ) {
+	while( n ) {
+		limbs.push_back( uint32_t( n ) );
+		n >>= 32;
+	}
+}
+
+std::ostream& operator<<( std::ostream& os, const natural& n ) {
+	return os << n.toString();
+}
+
+natural factorial( int n ) {
+	natural r( 1 );
+	for( int i = 2; i <= n; ++i )
+		r *= natural( i );
+	return r;
+}
+
+natural powerOfTwo( unsigned k ) {
+	natural r( uint64_t( 1 ) << ( k % 32 ) );
+	r.limbs.insert( r.limbs.begin(), k / 32, 0 );
+	return r;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+// arbitrary precision non-negative integer
+class natural {
+	std::vector<uint32_t> limbs; // least significant first, no leading zeros
+	void trim();
+public:
+	bool isZero() const;
+	natural& operator+=( const natural& );
+	natural& operator*=( const natural& );
+	natural operator+( const natural& ) const;
+	natural operator*( const natural& ) const;
+	bool operator<( const natural& ) const;
+	bool operator<=( const natural& ) const;
+	bool operator>( const natural& ) const;
+	bool operator>=( const natural& ) const;
+	bool operator==( const natural& ) const;
+	bool operator!=( const natural& ) const;
+
+	// returns the binary logarithm, -infinity for zero
+	double log2() const;
+
+	// returns the decimal representation
+	std::string toString() const;
+
+	// converts to a fixed size integer, saturating at its maximum
+	explicit operator __int128_t() const;
+	explicit operator double() const;
+
+	natural( uint64_t n = 0 );
+
+	friend natural powerOfTwo( unsigned k );
+};
+
+std::ostream& operator<<( std::ostream& os, const natural& n );
+
+// returns n!
+natural factorial( int n );
+
+// returns 2^k
+natural powerOfTwo( unsigned k );
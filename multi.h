@@ -12,4 +12,132 @@ This file contains settings on multi-threading.
 #include <future>
 #else
 #define THREADS		1
-#endif
\ No newline at end of file
+#endif
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+// splits {0,...,count-1} into at most THREADS consecutive ranges, evaluates f( begin, end ) for
+// each of them, concurrently when THREADED, and returns the results in the order of the ranges
+template<typename F>
+auto parallelRanges( size_t count, F f ) -> std::vector<decltype( f( size_t(), size_t() ) )> {
+	typedef decltype( f( size_t(), size_t() ) ) R;
+	size_t parts = std::max<size_t>( 1, std::min<size_t>( THREADS, count ) );
+	std::vector<R> results( parts );
+	#ifdef THREADED
+	std::vector<std::future<R>> futures;
+	for( size_t i = 1; i < parts; ++i )
+		futures.push_back( std::async( std::launch::async, f, count * i / parts, count * ( i + 1 ) / parts ) );
+	#endif
+	results[0] = f( 0, count / parts );
+	#ifdef THREADED
+	for( size_t i = 1; i < parts; ++i )
+		results[i] = futures[i-1].get();
+	#endif
+	return results;
+}
+
+// value computed on first use, which threads may share
+// *************************************************************
+// A thread that finds the value missing takes a lock and
+// computes it, unless another thread has done so meanwhile.
+// Once the value is there, reading it costs one atomic load and
+// no lock. A computation may also decide not to keep its result,
+// e.g. when it stopped early; the next use then computes again.
+// *************************************************************
+template<typename T>
+class Lazy {
+	mutable std::atomic<bool> _ready;
+	mutable std::mutex _lock;
+	mutable T _value;
+public:
+	// checks whether the value is there
+	bool ready() const;
+
+	// returns the value, which must be there
+	const T& value() const;
+
+	// returns the value, computing it with compute() first when it is missing
+	template<typename F> const T& get( const F& compute ) const;
+
+	// returns the value when it is there, otherwise the result of compute(), which is kept when keep( result ) holds
+	template<typename F, typename K> T get( const F& compute, const K& keep ) const;
+
+	// sets the value, before the object is shared
+	void set( T value );
+
+	Lazy();
+	Lazy( const Lazy& other );
+	Lazy& operator=( const Lazy& other );
+};
+
+// ----------------------------------------------------------------
+
+template<typename T>
+bool Lazy<T>::ready() const {
+	return _ready.load( std::memory_order_acquire );
+}
+
+template<typename T>
+const T& Lazy<T>::value() const {
+	return _value;
+}
+
+template<typename T>
+template<typename F>
+const T& Lazy<T>::get( const F& compute ) const {
+	if( not ready() ) {
+		std::lock_guard<std::mutex> guard( _lock );
+		if( not _ready.load( std::memory_order_relaxed ) ) {
+			_value = compute();
+			_ready.store( true, std::memory_order_release );
+		}
+	}
+	return _value;
+}
+
+template<typename T>
+template<typename F, typename K>
+T Lazy<T>::get( const F& compute, const K& keep ) const {
+	if( ready() )
+		return _value;
+	std::lock_guard<std::mutex> guard( _lock );
+	if( _ready.load( std::memory_order_relaxed ) )
+		return _value;
+	T result = compute();
+	if( keep( result ) ) {
+		_value = result;
+		_ready.store( true, std::memory_order_release );
+	}
+	return result;
+}
+
+template<typename T>
+void Lazy<T>::set( T value ) {
+	_value = std::move( value );
+	_ready.store( true, std::memory_order_release );
+}
+
+template<typename T>
+Lazy<T>::Lazy() : _ready( false ), _value() {
+}
+
+template<typename T>
+Lazy<T>::Lazy( const Lazy& other ) : _ready( false ), _value() {
+	*this = other;
+}
+
+template<typename T>
+Lazy<T>& Lazy<T>::operator=( const Lazy& other ) {
+	if( this == &other )
+		return *this;
+	if( other.ready() ) {
+		_value = other._value;
+		_ready.store( true, std::memory_order_release );
+	} else {
+		_value = T();
+		_ready.store( false, std::memory_order_release );
+	}
+	return *this;
+}
@@ -3,151 +3,559 @@
 #include <exception>
 #include <stdexcept>
 #include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <functional>
+#include <limits>
+#include <cmath>
+#include <map>
 #include <ext.h>
 
 #include "permutation.h"
 
 
-int Permutation::degree() const {
-	return _map.size();
+namespace {
+	// calls f with a null pointer to the image type of width w
+	template<typename F>
+	void dispatch( int w, F&& f ) {
+		switch( w ) {
+			case 1:
+				f( static_cast<uint8_t*>( nullptr ) );
+				break;
+			case 2:
+				f( static_cast<uint16_t*>( nullptr ) );
+				break;
+			default:
+				f( static_cast<uint32_t*>( nullptr ) );
+		}
+	}
+
+	template<typename E>
+	using image_type = typename std::remove_pointer<E>::type;
+}
+
+namespace {
+	// set once the pool of a thread is destroyed, later releases go to the allocator
+	thread_local bool pool_destroyed = false;
+}
+
+std::atomic<size_t> ScratchPool::_allocations( 0 );
+
+ScratchPool& ScratchPool::local() {
+	static thread_local ScratchPool pool;
+	return pool;
+}
+
+void* ScratchPool::acquire( size_t bytes ) {
+	for( auto& b : _buckets ) {
+		if( b.bytes == bytes and not b.buffers.empty() ) {
+			void* buffer = b.buffers.back();
+			b.buffers.pop_back();
+			return buffer;
+		}
+	}
+	_allocations.fetch_add( 1, std::memory_order_relaxed );
+	return ::operator new( bytes );
+}
+
+void ScratchPool::release( void* buffer, size_t bytes ) {
+	if( not pool_destroyed ) {
+		for( auto& b : _buckets ) {
+			if( b.bytes == bytes ) {
+				if( b.buffers.size() < capacity ) {
+					b.buffers.push_back( buffer );
+					return;
+				}
+				break;
+			}
+		}
+		if( _buckets.size() < capacity ) {
+			bucket b;
+			b.bytes = bytes;
+			b.buffers.push_back( buffer );
+			_buckets.push_back( std::move( b ) );
+			return;
+		}
+	}
+	::operator delete( buffer );
+}
+
+size_t ScratchPool::allocations() {
+	return _allocations.load( std::memory_order_relaxed );
+}
+
+ScratchPool::~ScratchPool() {
+	pool_destroyed = true;
+	for( auto& b : _buckets )
+		for( void* buffer : b.buffers )
+			::operator delete( buffer );
+}
+
+// ----------------------------------------------------------------------------
+
+void Permutation::allocate() {
+	if( not isInline() )
+		_heap = ScratchPool::local().acquire( bytes() );
+}
+
+void Permutation::release() {
+	if( not isInline() ) {
+		if( pool_destroyed )
+			::operator delete( _heap );
+		else
+			ScratchPool::local().release( _heap, bytes() );
+	}
+	_degree = 0;
+}
+
+void Permutation::resize( int n ) {
+	if( n != _degree ) {
+		release();
+		_degree = std::max( n, 0 );
+		allocate();
+	}
+	invalidate();
+}
+
+void Permutation::invalidate() {
+	_fingerprint.store( 0, std::memory_order_relaxed );
+	_cycles.reset();
+}
+
+uint64_t Permutation::fingerprintTerm( int i, int v ) {
+	// splitmix64 finaliser
+	uint64_t z = ( uint64_t( i ) << 32 | uint32_t( v ) ) + 0x9E3779B97F4A7C15ull;
+	z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+	z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBull;
+	return z ^ ( z >> 31 );
+}
+
+uint64_t Permutation::fingerprint() const {
+	// the cache is a single word, so relaxed accesses suffice; a fingerprint of 0 is recomputed every time
+	uint64_t h = _fingerprint.load( std::memory_order_relaxed );
+	if( h == 0 ) {
+		h = PermutationRef( *this ).fingerprint();
+		_fingerprint.store( h, std::memory_order_relaxed );
+	}
+	return h;
 }
 
 bool Permutation::isIdentity() const {
-	for( int i = 0; i < degree(); i++ )
-		if( (*this)(i) != i )
-			return false;
-	return true;
+	return kernels::isIdentity( width(), storage(), _degree );
 }
 
-int Permutation::order() const {
-	if( _order != -1 )
-		return _order;
-	Permutation p = (*this);
-	_order = 1;
-	while( !p.isIdentity() ) {
-		p *= (*this);
-		_order++;
+const CycleStructure& Permutation::cycles() const {
+	std::shared_ptr<const CycleStructure> C = std::atomic_load( &_cycles );
+	if( not C ) {
+		// when another thread stored a decomposition first, that one is kept and returned
+		auto D = std::make_shared<const CycleStructure>( *this );
+		if( std::atomic_compare_exchange_strong( &_cycles, &C, D ) )
+			C = D;
 	}
-	return _order;
+	return *C;
+}
+
+int Permutation::order() const {
+	natural r = exactOrder();
+	if( r > natural( std::numeric_limits<int>::max() ) )
+		throw std::overflow_error( "Order of permutation does not fit in an int" );
+	return int( __int128_t( r ) );
+}
+
+natural Permutation::exactOrder() const {
+	return cycles().order();
+}
+
+double Permutation::log2Order() const {
+	return cycles().log2Order();
+}
+
+const std::vector<int>& Permutation::cycleType() const {
+	return cycles().cycleType();
+}
+
+bool Permutation::isConjugate( const Permutation& other ) const {
+	return degree() == other.degree() and cycles().isConjugate( other.cycles() );
 }
 
 Permutation Permutation::project( const std::vector<int>& Delta ) const {
-	std::vector<int> mapping( degree(), -1 );
+	Permutation r( 0 );
+	projectInto( r, Delta );
+	return r;
+}
+
+void Permutation::projectInto( Permutation& dst, const std::vector<int>& Delta ) const {
+	size_t bytes = sizeof( int ) * degree();
+	int* mapping = static_cast<int*>( ScratchPool::local().acquire( bytes ) );
 	for( size_t i = 0; i < Delta.size(); ++i )
 		mapping[ Delta[i] ] = i;
-	std::vector<int> perm( Delta.size() );
-	for( size_t i = 0; i < Delta.size(); ++i )
-		perm[i] = mapping[ (*this)( Delta[i] ) ];
-	return Permutation( std::move( perm ) );
+	dst.resize( Delta.size() );
+	dispatch( dst.width(), [&]( auto tag ) {
+		typedef image_type<decltype(tag)> E;
+		E* v = static_cast<E*>( dst.storage() );
+		for( size_t i = 0; i < Delta.size(); ++i )
+			v[i] = mapping[ (*this)( Delta[i] ) ];
+	} );
+	ScratchPool::local().release( mapping, bytes );
 }
 
 bool Permutation::operator<( const Permutation& other ) const {
 	if( degree() != other.degree() )
 		throw std::range_error( "Permutations not compatible" );
-	for( int i = 0; i < degree(); i++ )
-		if( (*this)(i) < other(i) )
-			return true;
-		else if( (*this)(i) > other(i) )
-			return false;
-	return false;
+	bool r = false;
+	dispatch( width(), [&]( auto tag ) {
+		typedef image_type<decltype(tag)> E;
+		const E* p = this->images<E>();
+		const E* q = other.images<E>();
+		auto d = std::mismatch( p, p + _degree, q );
+		r = d.first != p + _degree and *d.first < *d.second;
+	} );
+	return r;
 }
 
 bool Permutation::operator==( const Permutation& other ) const {
 	if( degree() != other.degree() )
 		throw std::range_error( "Permutations not compatible" );
-	return _map == other._map;
+	uint64_t a = _fingerprint.load( std::memory_order_relaxed );
+	uint64_t b = other._fingerprint.load( std::memory_order_relaxed );
+	if( a and b and a != b )
+		return false;
+	return kernels::equal( width(), storage(), other.storage(), _degree );
 }
 
 bool Permutation::operator!=( const Permutation& other ) const {
 	return !( *this == other);
 }
 
-int Permutation::operator()( int k ) const {
-	return _map[k];
-}
-
-const std::vector<int>& Permutation::getArrayNotation() const {
-	return _map;
+std::vector<int> Permutation::getArrayNotation() const {
+	std::vector<int> v( degree() );
+	dispatch( width(), [&]( auto tag ) {
+		const auto* p = this->images<image_type<decltype(tag)>>();
+		std::copy( p, p + _degree, v.begin() );
+	} );
+	return v;
 }
 
 std::vector<std::vector<int>> Permutation::getCycleNotation() const {
 	std::vector<std::vector<int>> cycles;
-	std::vector<bool> done( degree(), false );
-	for( int i = 0; i < degree(); i++ ) {
-		if( not done[i] ) {
-			int j = i;
-			std::vector<int> cycle;
-			do {
-				done[j] = true;
-				cycle.push_back( j );
-				j = (*this)(j);
-			} while( i != j );
-			if( cycle.size() != 1 )
-				cycles.emplace_back( std::move( cycle ) );
-			else
-				cycle.clear();
-		}
-	}
+	const CycleStructure& C = this->cycles();
+	const auto& P = C.points();
+	const auto& O = C.offsets();
+	for( size_t c = 0; c < C.size(); ++c )
+		if( C.length( c ) != 1 )
+			cycles.emplace_back( P.begin() + O[c], P.begin() + O[c+1] );
 	return cycles;
 }
 
 Permutation Permutation::operator*( const Permutation& sigma ) const {
 	if( degree() != sigma.degree() )
 		throw std::range_error( "Permutations not compatible" );
-	std::vector<int> v( degree() );
-	for( int i = 0; i < degree(); i++ )
-		v[i] = (*this)(sigma(i));
-	return Permutation( std::move(v) );
+	Permutation r( degree(), no_init() );
+	kernels::compose( width(), r.storage(), storage(), sigma.storage(), _degree );
+	return r;
 }
 
 Permutation& Permutation::operator*=( const Permutation& sigma ) {
-	Permutation p = (*this) * sigma;
-	_map = move( p._map );
-	_order = -1;
+	composeInto( *this, *this, sigma );
 	return *this;
 }
 
-Permutation Permutation::operator^( int k ) const {
-	Permutation p = (*this);
-	std::vector<int> v( degree() );
-	for( int i = 0; i < degree(); i++ )
-		v[i] = i;
-	Permutation t( std::move( v ) );
-	if( k < 0 ) {
-		p = p.inverse();
-		k = -k;
+Permutation& Permutation::leftMultiplyInPlace( PermutationRef tau ) {
+	composeInto( *this, tau, *this );
+	return *this;
+}
+
+void Permutation::composeInto( Permutation& dst, PermutationRef a, PermutationRef b ) {
+	if( a.degree() != b.degree() )
+		throw std::range_error( "Permutations not compatible" );
+	if( a.data() == dst.storage() ) {
+		// the kernel may not write to its table, so copy it aside first
+		ScratchPool& pool = ScratchPool::local();
+		size_t bytes = dst.bytes();
+		void* table = pool.acquire( bytes );
+		std::memcpy( table, a.data(), bytes - kernels::padding );
+		kernels::compose( a.width(), dst.storage(), table, b.data(), a.degree() );
+		pool.release( table, bytes );
+	} else {
+		dst.resize( a.degree() );
+		kernels::compose( a.width(), dst.storage(), a.data(), b.data(), a.degree() );
 	}
-	for( int i = 0; i < k; i++ )
-		t *= p;
-	return t;
+	dst.invalidate();
+}
+
+void Permutation::invertInto( Permutation& dst ) const {
+	PermutationRef( *this ).invertInto( dst );
+}
+
+Permutation Permutation::operator^( int k ) const {
+	const CycleStructure& C = cycles();
+	const auto& P = C.points();
+	const auto& O = C.offsets();
+	Permutation r( degree(), no_init() );
+	dispatch( width(), [&]( auto tag ) {
+		typedef image_type<decltype(tag)> E;
+		E* v = static_cast<E*>( r.storage() );
+		for( size_t c = 0; c < C.size(); ++c ) {
+			int l = C.length( c );
+			int s = ( k % l + l ) % l;
+			const int* X = P.data() + O[c];
+			for( int j = 0; j < l; ++j )
+				v[ X[j] ] = X[ j + s < l ? j + s : j + s - l ];
+		}
+	} );
+	return r;
 }
 
 Permutation& Permutation::operator^=( int k ) {
-	Permutation p = (*this) ^ k;
-	_map = move( p._map );
-	_order = -1;
-	return *this;
+	return *this = (*this) ^ k;
 }
 
 Permutation Permutation::inverse() const {
-	std::vector<int> v( degree() );
-	for( int i = 0; i < degree(); i++ )
-		v[ (*this)(i) ] = i;
-	return Permutation( std::move( v ) );
+	Permutation r( degree(), no_init() );
+	kernels::invert( width(), r.storage(), storage(), _degree );
+	return r;
+}
+
+Permutation::Permutation( int n, no_init ) : _degree( std::max( n, 0 ) ), _fingerprint( 0 ) {
+	allocate();
+}
+
+Permutation::Permutation( int n ) : Permutation( n, no_init() ) {
+	dispatch( width(), [&]( auto tag ) {
+		typedef image_type<decltype(tag)> E;
+		E* v = static_cast<E*>( this->storage() );
+		for( int i = 0; i < _degree; i++ )
+			v[i] = i;
+	} );
+}
+
+Permutation::Permutation( std::vector<int>&& m ) : Permutation( m.size(), no_init() ) {
+	dispatch( width(), [&]( auto tag ) {
+		typedef image_type<decltype(tag)> E;
+		std::copy( m.begin(), m.end(), static_cast<E*>( this->storage() ) );
+	} );
+}
+
+Permutation::Permutation( std::initializer_list<int> l ) : Permutation( std::vector<int>( l ) ) {
+}
+
+Permutation::Permutation( PermutationRef sigma ) : Permutation( sigma.degree(), no_init() ) {
+	std::memcpy( storage(), sigma.data(), size_t( _degree ) * width() );
+}
+
+Permutation::Permutation( const Permutation& other ) : Permutation( other._degree, no_init() ) {
+	_fingerprint.store( other._fingerprint.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+	_cycles = std::atomic_load( &other._cycles );
+	std::memcpy( storage(), other.storage(), size_t( _degree ) * width() );
+}
+
+Permutation::Permutation( Permutation&& other ) : _degree( other._degree ), _fingerprint( other._fingerprint.load( std::memory_order_relaxed ) ), _cycles( std::move( other._cycles ) ) {
+	if( isInline() )
+		std::memcpy( _inline, other._inline, size_t( _degree ) * width() );
+	else
+		_heap = other._heap;
+	other._degree = 0;
+}
+
+Permutation& Permutation::operator=( const Permutation& other ) {
+	if( this != &other ) {
+		resize( other._degree );
+		_fingerprint.store( other._fingerprint.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+		_cycles = std::atomic_load( &other._cycles );
+		std::memcpy( storage(), other.storage(), size_t( _degree ) * width() );
+	}
+	return *this;
 }
 
-Permutation::Permutation( int n ) : _order( 1 ) {
-	if( n <= 0 )
-		n = 0;
-	_map.resize( n );
-	for( int i = 0; i < n; i++ )
-		_map[i] = i;
+Permutation& Permutation::operator=( Permutation&& other ) {
+	if( this != &other ) {
+		release();
+		_degree = other._degree;
+		_fingerprint.store( other._fingerprint.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+		_cycles = std::move( other._cycles );
+		if( isInline() )
+			std::memcpy( _inline, other._inline, size_t( _degree ) * width() );
+		else
+			_heap = other._heap;
+		other._degree = 0;
+	}
+	return *this;
+}
+
+Permutation::~Permutation() {
+	release();
+}
+
+std::vector<Permutation> composeAll( const std::vector<Permutation>& S, const Permutation& sigma ) {
+	std::vector<Permutation> R( S.size(), Permutation( sigma.degree() ) );
+	std::vector<void*> dst( S.size() );
+	std::vector<const void*> src( S.size() );
+	for( size_t k = 0; k < S.size(); ++k ) {
+		if( S[k].degree() != sigma.degree() )
+			throw std::range_error( "Permutations not compatible" );
+		dst[k] = R[k].storage();
+		src[k] = S[k].storage();
+	}
+	kernels::composeBatch( sigma.width(), dst.data(), src.data(), sigma.storage(), sigma.degree(), S.size() );
+	return R;
+}
+
+std::vector<Permutation> composeAll( const Permutation& sigma, const std::vector<Permutation>& S ) {
+	std::vector<Permutation> R( S.size(), Permutation( sigma.degree() ) );
+	std::vector<void*> dst( S.size() );
+	std::vector<const void*> src( S.size() );
+	for( size_t k = 0; k < S.size(); ++k ) {
+		if( S[k].degree() != sigma.degree() )
+			throw std::range_error( "Permutations not compatible" );
+		dst[k] = R[k].storage();
+		src[k] = S[k].storage();
+	}
+	kernels::composeBatch( sigma.width(), dst.data(), sigma.images<uint8_t>(), src.data(), sigma.degree(), S.size() );
+	return R;
 }
 
-Permutation::Permutation( std::vector<int>&& m ) : _map( m ), _order( -1 )  {
+bool PermutationRef::isIdentity() const {
+	return kernels::isIdentity( width(), _data, _degree );
+}
+
+uint64_t PermutationRef::fingerprint() const {
+	uint64_t h = 0;
+	dispatch( width(), [&]( auto tag ) {
+		const auto* p = this->images<image_type<decltype(tag)>>();
+		for( int i = 0; i < _degree; i++ )
+			h += Permutation::fingerprintTerm( i, p[i] );
+	} );
+	return h;
+}
+
+void PermutationRef::invertInto( Permutation& dst ) const {
+	if( _data == dst.storage() ) {
+		Permutation r( 0 );
+		invertInto( r );
+		dst = std::move( r );
+		return;
+	}
+	dst.resize( _degree );
+	kernels::invert( width(), dst.storage(), _data, _degree );
+}
+
+// ----------------------------------------------------------------------------
+
+size_t CycleStructure::size() const {
+	return _offsets.size() - 1;
 }
 
-Permutation::Permutation( std::initializer_list<int> l ) : _map( l ), _order( -1 ) {
+int CycleStructure::length( size_t c ) const {
+	return _offsets[c+1] - _offsets[c];
+}
+
+const std::vector<int>& CycleStructure::points() const {
+	return _points;
+}
+
+const std::vector<int>& CycleStructure::offsets() const {
+	return _offsets;
+}
+
+const std::vector<int>& CycleStructure::cycleType() const {
+	return _type;
+}
+
+namespace {
+	// returns the prime powers whose product is the lcm of the integers in L
+	std::vector<std::pair<int,int>> lcm_factorisation( const std::vector<int>& L ) {
+		std::vector<std::pair<int,int>> f;
+		std::vector<int> M( L );
+		M.erase( std::unique( M.begin(), M.end() ), M.end() );
+		std::map<int,int> exponent;
+		for( int l : M ) {
+			for( int p = 2; p * p <= l; ++p ) {
+				int e = 0;
+				while( l % p == 0 ) {
+					l /= p;
+					++e;
+				}
+				if( e > exponent[p] )
+					exponent[p] = e;
+			}
+			if( l > 1 and exponent[l] < 1 )
+				exponent[l] = 1;
+		}
+		for( const auto& x : exponent )
+			if( x.second > 0 )
+				f.emplace_back( x.first, x.second );
+		return f;
+	}
+}
+
+natural CycleStructure::order() const {
+	natural r( 1 );
+	for( const auto& pe : lcm_factorisation( _type ) )
+		for( int i = 0; i < pe.second; ++i )
+			r *= natural( pe.first );
+	return r;
+}
+
+double CycleStructure::log2Order() const {
+	double r = 0;
+	for( const auto& pe : lcm_factorisation( _type ) )
+		r += pe.second * std::log2( pe.first );
+	return r;
+}
+
+bool CycleStructure::isConjugate( const CycleStructure& other ) const {
+	return _type == other._type;
+}
+
+CycleStructure::CycleStructure( const Permutation& sigma ) {
+	int n = sigma.degree();
+	_points.reserve( n );
+	std::vector<bool> done( n, false );
+	for( int i = 0; i < n; ++i ) {
+		if( not done[i] ) {
+			_offsets.push_back( _points.size() );
+			int j = i;
+			do {
+				done[j] = true;
+				_points.push_back( j );
+				j = sigma( j );
+			} while( j != i );
+			_type.push_back( _points.size() - _offsets.back() );
+		}
+	}
+	_offsets.push_back( n );
+	std::sort( _type.begin(), _type.end(), std::greater<int>() );
+}
+
+size_t PermutationInterner::hasher::operator()( const std::shared_ptr<const Permutation>& sigma ) const {
+	return sigma->fingerprint();
+}
+
+bool PermutationInterner::equal::operator()( const std::shared_ptr<const Permutation>& sigma, const std::shared_ptr<const Permutation>& tau ) const {
+	return sigma->degree() == tau->degree() and *sigma == *tau;
+}
+
+std::shared_ptr<const Permutation> PermutationInterner::intern( Permutation sigma ) {
+	auto p = std::make_shared<const Permutation>( std::move( sigma ) );
+	return *_table.insert( std::move( p ) ).first;
+}
+
+bool PermutationInterner::contains( const Permutation& sigma ) const {
+	// the table only compares through the pointers, so wrap sigma without taking ownership
+	std::shared_ptr<const Permutation> p( &sigma, []( const Permutation* ) {} );
+	return _table.count( p ) > 0;
+}
+
+size_t PermutationInterner::size() const {
+	return _table.size();
+}
+
+void PermutationInterner::collect() {
+	for( auto i = _table.begin(); i != _table.end(); )
+		if( i->use_count() == 1 )
+			i = _table.erase( i );
+		else
+			++i;
 }
 
 std::ostream& operator<<( std::ostream& os, const Permutation& sigma ) {
@@ -178,7 +586,30 @@ all_permutations::iterator::self_type all_permutations::iterator::operator++(int
 }
 
 all_permutations::iterator::self_type& all_permutations::iterator::operator++() {
-	if( !std::next_permutation( _p._map.begin(), _p._map.end() ) )
+	bool next = false;
+	dispatch( _p.width(), [&]( auto tag ) {
+		typedef image_type<decltype(tag)> E;
+		E* v = static_cast<E*>( _p.storage() );
+		int n = _p.degree();
+		// only the suffix after the last ascent changes, update the fingerprint there
+		int k = n - 1;
+		while( k > 0 and v[k-1] > v[k] )
+			--k;
+		k = std::max( k - 1, 0 );
+		uint64_t h = _p._fingerprint.load( std::memory_order_relaxed );
+		bool hashed = h != 0;
+		if( hashed )
+			for( int i = k; i < n; i++ )
+				h -= Permutation::fingerprintTerm( i, v[i] );
+		next = std::next_permutation( v, v + n );
+		if( hashed ) {
+			for( int i = k; i < n; i++ )
+				h += Permutation::fingerprintTerm( i, v[i] );
+			_p._fingerprint.store( h, std::memory_order_relaxed );
+		}
+	} );
+	_p._cycles.reset();
+	if( !next )
 		_n = -1;
 	return *this;
 }
@@ -6,27 +6,162 @@
 #include <set>
 #include <exception>
 #include <deque>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <unordered_set>
+#include <functional>
+#include <natural.h>
+
+#include "permutation_kernels.h"
 
 class all_permutations;
+class CycleStructure;
+class Permutation;
+class PermutationArena;
+
+// per-thread cache of image buffers, shared by the permutations and temporaries of a thread
+class ScratchPool {
+	struct bucket {
+		size_t bytes;
+		std::vector<void*> buffers;
+	};
+	std::vector<bucket> _buckets;
+	static std::atomic<size_t> _allocations;
+public:
+	// maximum number of buffers kept for each size
+	static const size_t capacity = 256;
+
+	// returns the pool of the calling thread
+	static ScratchPool& local();
+
+	// returns a buffer of the given size
+	void* acquire( size_t bytes );
+
+	// returns a buffer of the given size to the pool
+	void release( void* buffer, size_t bytes );
+
+	// returns the number of buffers requested from the allocator by all pools
+	static size_t allocations();
+
+	~ScratchPool();
+};
+
+// read-only view of the images of a permutation stored elsewhere, e.g. in a PermutationArena
+class PermutationRef {
+	const void* _data;
+	int _degree;
+public:
+	// returns the degree of the permutation
+	int degree() const;
+
+	// returns the number of bytes used to store a single image
+	int width() const;
+
+	// returns the images in array notation
+	const void* data() const;
+	template<typename E> const E* images() const;
+
+	// defines the action of the permutation on the integers {0,...,n-1}
+	int operator()( int ) const;
+
+	// checks whether the permutation is the identity
+	bool isIdentity() const;
+
+	// computes the fingerprint of the permutation, see Permutation::fingerprint
+	uint64_t fingerprint() const;
+
+	// stores the inverse of the permutation in dst, reusing the storage of dst
+	void invertInto( Permutation& dst ) const;
+
+	// constructs a view of n images of width Permutation::imageWidth( n ) at data
+	PermutationRef( const void* data, int n );
+};
 
 // describes a permutation of the elements {0,...,n-1}
+// *************************************************************
+// The images are stored in the narrowest unsigned type that can
+// hold them: uint8_t for n <= 256, uint16_t for n <= 65536 and
+// uint32_t otherwise. Permutations whose images fit in
+// inline_capacity bytes are stored inside the object itself and
+// never touch the allocator.
+// The arithmetic is done by the kernels in permutation_kernels.h.
+// *************************************************************
 class Permutation {
 	friend class all_permutations;
+	friend class PermutationRef;
+	friend std::vector<Permutation> composeAll( const std::vector<Permutation>&, const Permutation& );
+	friend std::vector<Permutation> composeAll( const Permutation&, const std::vector<Permutation>& );
+public:
+	// number of bytes of images stored inside the object
+	static const int inline_capacity = 48;
+private:
+	int _degree;
+	// the caches are filled by const methods, possibly from several threads at once
+	mutable std::atomic<uint64_t> _fingerprint; // 0 until computed
+	mutable std::shared_ptr<const CycleStructure> _cycles; // only accessed through std::atomic_load and friends
+	union {
+		uint8_t _inline[inline_capacity + kernels::padding];
+		void* _heap;
+	};
 
-	std::vector<int> _map;
-	mutable int _order;
+	struct no_init {};
+	Permutation( int n, no_init );
+
+	bool isInline() const;
+	size_t bytes() const;
+	void* storage();
+	const void* storage() const;
+	void allocate();
+	void release();
+	void resize( int n );
+	void invalidate();
+
+	// contribution of the image v of point i to the fingerprint
+	static uint64_t fingerprintTerm( int i, int v );
 public:
+	// view and contiguous storage types, see permutation_arena.h
+	typedef PermutationRef reference;
+	typedef PermutationArena arena_type;
+
+	// returns the number of bytes used to store a single image for permutations of degree n
+	static int imageWidth( int n );
+
 	// returns the degree of the permutation
 	int degree() const;
 
+	// returns the number of bytes used to store a single image
+	int width() const;
+
+	// returns the images in array notation, E should have width() bytes
+	template<typename E> const E* images() const;
+
+	// returns a 64-bit hash of the permutation (cached)
+	// it is the sum of a term for every point, so changing a few images updates it cheaply
+	uint64_t fingerprint() const;
+
+	// returns the cycle decomposition of the permutation (cached)
+	const CycleStructure& cycles() const;
+
 	// returns the order of the permutation
+	// throws std::overflow_error when it does not fit in an int, see exactOrder
 	int order() const;
 
+	// returns the order of the permutation as lcm of its cycle lengths
+	natural exactOrder() const;
+	double log2Order() const;
+
+	// returns the cycle lengths in non-increasing order, fixed points included
+	const std::vector<int>& cycleType() const;
+
+	// checks whether the permutations are conjugate in the symmetric group
+	bool isConjugate( const Permutation& ) const;
+
 	// checks whether the permutation is the identity
 	bool isIdentity() const;
 
 	// returns its representation in array notation
-	const std::vector<int>& getArrayNotation() const;
+	std::vector<int> getArrayNotation() const;
 
 	// returns its representation in cycle notation
 	std::vector<std::vector<int>> getCycleNotation() const;
@@ -47,9 +182,19 @@ public:
 	// returns the inverse of the permutation
 	Permutation inverse() const;
 
+	// replaces the permutation by tau * this, without allocating
+	Permutation& leftMultiplyInPlace( PermutationRef tau );
+
+	// stores the inverse of the permutation in dst, reusing the storage of dst
+	void invertInto( Permutation& dst ) const;
+
+	// stores a * b in dst, reusing the storage of dst
+	static void composeInto( Permutation& dst, PermutationRef a, PermutationRef b );
+
 	// returns the restriction of the permutation to the domain Delta
 	// WARNING: undefined behaviour when Delta is not invariant under the permutation
 	Permutation project( const std::vector<int>& Delta ) const;
+	void projectInto( Permutation& dst, const std::vector<int>& Delta ) const;
 
 	// defines the action of the permutation on the integers {0,...,n-1}
 	int operator()( int ) const;
@@ -60,6 +205,49 @@ public:
 	// constructs a permutation from array notation
 	Permutation( std::vector<int>&& );
 	Permutation( std::initializer_list<int> );
+
+	// copies the images of a view
+	explicit Permutation( PermutationRef );
+
+	// returns a view of the images
+	operator PermutationRef() const;
+
+	Permutation( const Permutation& );
+	Permutation( Permutation&& );
+	Permutation& operator=( const Permutation& );
+	Permutation& operator=( Permutation&& );
+	~Permutation();
+};
+
+// decomposition of a permutation into disjoint cycles, fixed points included
+class CycleStructure {
+	std::vector<int> _points;  // the points listed cycle by cycle
+	std::vector<int> _offsets; // start of each cycle in _points, followed by the degree
+	std::vector<int> _type;    // cycle lengths in non-increasing order
+public:
+	// returns the number of cycles
+	size_t size() const;
+
+	// returns the length of cycle c
+	int length( size_t c ) const;
+
+	// returns the points listed cycle by cycle, cycle c starts at offsets()[c]
+	const std::vector<int>& points() const;
+	const std::vector<int>& offsets() const;
+
+	// returns the cycle lengths in non-increasing order
+	const std::vector<int>& cycleType() const;
+
+	// returns the lcm of the cycle lengths
+	natural order() const;
+
+	// returns the binary logarithm of the order
+	double log2Order() const;
+
+	// checks whether the cycle types are equal
+	bool isConjugate( const CycleStructure& ) const;
+
+	CycleStructure( const Permutation& sigma );
 };
 
 // iterable over all permutations of {0,...,n-1}
@@ -90,5 +278,127 @@ public:
 	all_permutations( int n );
 };
 
+// returns the products tau * sigma for all tau in S
+std::vector<Permutation> composeAll( const std::vector<Permutation>& S, const Permutation& sigma );
+
+// returns the products sigma * tau for all tau in S
+std::vector<Permutation> composeAll( const Permutation& sigma, const std::vector<Permutation>& S );
+
+namespace std {
+	template<>
+	struct hash<Permutation> {
+		size_t operator()( const Permutation& sigma ) const {
+			return sigma.fingerprint();
+		}
+	};
+}
+
+// unordered set of permutations
+typedef std::unordered_set<Permutation> PermutationSet;
+
+// table of unique permutations, equal permutations share a single copy
+class PermutationInterner {
+	struct hasher {
+		size_t operator()( const std::shared_ptr<const Permutation>& sigma ) const;
+	};
+	struct equal {
+		bool operator()( const std::shared_ptr<const Permutation>& sigma, const std::shared_ptr<const Permutation>& tau ) const;
+	};
+	std::unordered_set<std::shared_ptr<const Permutation>,hasher,equal> _table;
+public:
+	// returns the shared copy of sigma, adding sigma to the table if needed
+	std::shared_ptr<const Permutation> intern( Permutation sigma );
+
+	// checks whether a copy of sigma is in the table
+	bool contains( const Permutation& sigma ) const;
+
+	// returns the number of distinct permutations in the table
+	size_t size() const;
+
+	// removes all permutations that are not referenced outside the table
+	void collect();
+};
+
 // print a permutation in cycle notation to an output stream
-std::ostream& operator<<( std::ostream& os, const Permutation& cycles );
\ No newline at end of file
+std::ostream& operator<<( std::ostream& os, const Permutation& cycles );
+
+// ----------------------------------------------------------------------------
+
+inline int Permutation::imageWidth( int n ) {
+	return n <= 0x100 ? 1 : ( n <= 0x10000 ? 2 : 4 );
+}
+
+inline int Permutation::degree() const {
+	return _degree;
+}
+
+inline int Permutation::width() const {
+	return imageWidth( _degree );
+}
+
+inline bool Permutation::isInline() const {
+	return _degree * width() <= inline_capacity;
+}
+
+inline size_t Permutation::bytes() const {
+	return size_t( _degree ) * width() + kernels::padding;
+}
+
+inline void* Permutation::storage() {
+	return isInline() ? static_cast<void*>( _inline ) : _heap;
+}
+
+inline const void* Permutation::storage() const {
+	return isInline() ? static_cast<const void*>( _inline ) : _heap;
+}
+
+template<typename E>
+const E* Permutation::images() const {
+	return static_cast<const E*>( storage() );
+}
+
+inline PermutationRef::PermutationRef( const void* data, int n ) : _data( data ), _degree( n ) {
+}
+
+inline int PermutationRef::degree() const {
+	return _degree;
+}
+
+inline int PermutationRef::width() const {
+	return Permutation::imageWidth( _degree );
+}
+
+inline const void* PermutationRef::data() const {
+	return _data;
+}
+
+template<typename E>
+const E* PermutationRef::images() const {
+	return static_cast<const E*>( _data );
+}
+
+inline int PermutationRef::operator()( int k ) const {
+	switch( width() ) {
+		case 1:
+			return images<uint8_t>()[k];
+		case 2:
+			return images<uint16_t>()[k];
+		default:
+			return images<uint32_t>()[k];
+	}
+}
+
+inline Permutation::operator PermutationRef() const {
+	return PermutationRef( storage(), _degree );
+}
+
+inline int Permutation::operator()( int k ) const {
+	switch( width() ) {
+		case 1:
+			return images<uint8_t>()[k];
+		case 2:
+			return images<uint16_t>()[k];
+		default:
+			return images<uint32_t>()[k];
+	}
+}
@@ -0,0 +1,172 @@
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#include "permutation_arena.h"
+
+namespace {
+	size_t strideOf( int n ) {
+		size_t bytes = size_t( n ) * Permutation::imageWidth( n ) + kernels::padding;
+		return ( bytes + PermutationArena::alignment - 1 ) / PermutationArena::alignment * PermutationArena::alignment;
+	}
+}
+
+void PermutationArena::grow( size_t capacity ) {
+	size_t bytes = capacity * _stride;
+	char* data = nullptr;
+	bool mapped = false;
+#ifdef __linux__
+	if( _huge and bytes >= huge_threshold ) {
+		void* p = mmap( nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+		if( p != MAP_FAILED ) {
+			madvise( p, bytes, MADV_HUGEPAGE );
+			data = static_cast<char*>( p );
+			mapped = true;
+		}
+	}
+#endif
+	if( data == nullptr ) {
+		data = static_cast<char*>( aligned_alloc( alignment, bytes ) );
+		if( data == nullptr )
+			throw std::bad_alloc();
+	}
+	if( _size > 0 )
+		std::memcpy( data, _data, _size * _stride );
+	free();
+	_data = data;
+	_mapped = mapped;
+	_capacity = capacity;
+}
+
+void PermutationArena::free() {
+	if( _backing ) {
+		_backing.reset();
+		_data = nullptr;
+		return;
+	}
+	if( _data == nullptr )
+		return;
+#ifdef __linux__
+	if( _mapped )
+		munmap( _data, _capacity * _stride );
+	else
+#endif
+		std::free( _data );
+	_data = nullptr;
+	_mapped = false;
+}
+
+const void* PermutationArena::slot( PermutationRef sigma ) {
+	if( sigma.degree() != _degree )
+		throw std::range_error( "Permutation has wrong degree for arena" );
+	const char* p = static_cast<const char*>( sigma.data() );
+	if( _size == _capacity or _backing ) {
+		// sigma may live in this arena, in which case it moves along
+		bool own = _data != nullptr and p >= _data and p < _data + _size * _stride;
+		size_t offset = own ? p - _data : 0;
+		grow( _capacity == 0 ? 8 : 2 * _capacity );
+		if( own )
+			p = _data + offset;
+	}
+	return p;
+}
+
+size_t PermutationArena::push( PermutationRef sigma ) {
+	const void* p = slot( sigma );
+	std::memcpy( _data + _size * _stride, p, size_t( _degree ) * sigma.width() );
+	return _size++;
+}
+
+size_t PermutationArena::pushInverse( PermutationRef sigma ) {
+	const void* p = slot( sigma );
+	kernels::invert( sigma.width(), _data + _size * _stride, p, _degree );
+	return _size++;
+}
+
+void PermutationArena::reserve( size_t count ) {
+	if( count > _capacity or ( _backing and count > _size ) )
+		grow( std::max( count, _size ) );
+}
+
+void PermutationArena::clear() {
+	_size = 0;
+}
+
+void PermutationArena::reset( int n ) {
+	if( strideOf( n ) != _stride or _backing ) {
+		free();
+		_capacity = 0;
+		_stride = strideOf( n );
+	}
+	_degree = n;
+	_size = 0;
+}
+
+void PermutationArena::attach( const void* data, size_t count, int n, std::shared_ptr<const void> owner ) {
+	free();
+	_degree = n;
+	_stride = strideOf( n );
+	_size = _capacity = count;
+	_data = static_cast<char*>( const_cast<void*>( data ) );
+	_backing = std::move( owner );
+}
+
+bool PermutationArena::isAttached() const {
+	return bool( _backing );
+}
+
+PermutationArena::PermutationArena( int n, bool huge_pages ) : _degree( n ), _stride( strideOf( n ) ), _size( 0 ), _capacity( 0 ), _huge( huge_pages ), _mapped( false ), _data( nullptr ) {
+}
+
+PermutationArena::PermutationArena( const PermutationArena& other ) : PermutationArena( other._degree, other._huge ) {
+	if( other._size > 0 ) {
+		grow( other._size );
+		std::memcpy( _data, other._data, other._size * _stride );
+		_size = other._size;
+	}
+}
+
+PermutationArena::PermutationArena( PermutationArena&& other ) : _degree( other._degree ), _stride( other._stride ), _size( other._size ), _capacity( other._capacity ), _huge( other._huge ), _mapped( other._mapped ), _data( other._data ) {
+	_backing = std::move( other._backing );
+	other._data = nullptr;
+	other._size = 0;
+	other._capacity = 0;
+	other._mapped = false;
+}
+
+PermutationArena& PermutationArena::operator=( const PermutationArena& other ) {
+	if( this != &other ) {
+		PermutationArena copy( other );
+		*this = std::move( copy );
+	}
+	return *this;
+}
+
+PermutationArena& PermutationArena::operator=( PermutationArena&& other ) {
+	if( this != &other ) {
+		free();
+		_degree = other._degree;
+		_stride = other._stride;
+		_size = other._size;
+		_capacity = other._capacity;
+		_huge = other._huge;
+		_mapped = other._mapped;
+		_data = other._data;
+		_backing = std::move( other._backing );
+		other._data = nullptr;
+		other._size = 0;
+		other._capacity = 0;
+		other._mapped = false;
+	}
+	return *this;
+}
+
+PermutationArena::~PermutationArena() {
+	free();
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <memory>
+
+#include "permutation.h"
+
+// contiguous storage for many permutations of the same degree
+// *************************************************************
+// The images of all permutations are stored back to back in a
+// single aligned buffer, every slot padded to a multiple of the
+// cache line size. Building a table of permutations therefore
+// costs a logarithmic number of allocations and destroying it a
+// single free. On linux large arenas may be backed by huge pages.
+// Slots are addressed by index, which stays valid while the arena
+// grows; the views returned by operator[] do not.
+// An arena can also be attached to read-only storage in the same
+// layout, e.g. a mapped file, which it copies on the first push.
+// *************************************************************
+class PermutationArena {
+	int _degree;
+	size_t _stride;
+	size_t _size;
+	size_t _capacity;
+	bool _huge;
+	bool _mapped;
+	char* _data;
+	std::shared_ptr<const void> _backing; // owner of attached storage, null when _data is owned
+
+	void grow( size_t capacity );
+	void free();
+
+	// makes room for one more slot and returns the images of sigma, which may have moved
+	const void* slot( PermutationRef sigma );
+public:
+	// alignment of every slot in bytes
+	static const size_t alignment = 64;
+
+	// arenas of at least this many bytes are backed by huge pages when requested
+	static const size_t huge_threshold = size_t( 2 ) << 20;
+
+	// returns the degree of the permutations
+	int degree() const;
+
+	// returns the number of stored permutations
+	size_t size() const;
+
+	// returns the permutation in slot i
+	PermutationRef operator[]( size_t i ) const;
+
+	// copies sigma to a new slot and returns its index
+	size_t push( PermutationRef sigma );
+
+	// stores the inverse of sigma in a new slot and returns its index
+	size_t pushInverse( PermutationRef sigma );
+
+	// makes room for the given number of permutations
+	void reserve( size_t count );
+
+	// removes all permutations, keeping the buffer
+	void clear();
+
+	// removes all permutations and sets the degree
+	void reset( int n );
+
+	// returns the number of bytes between consecutive slots, and the images of all slots
+	size_t stride() const;
+	const void* data() const;
+
+	// replaces the contents by count permutations on n elements stored at data in the layout of data()
+	// data must be aligned to alignment and stays owned by owner, which is kept alive while it is used
+	void attach( const void* data, size_t count, int n, std::shared_ptr<const void> owner );
+
+	// checks whether the contents are attached storage
+	bool isAttached() const;
+
+	// constructs an empty arena for permutations on n elements
+	PermutationArena( int n = 0, bool huge_pages = false );
+	PermutationArena( const PermutationArena& );
+	PermutationArena( PermutationArena&& );
+	PermutationArena& operator=( const PermutationArena& );
+	PermutationArena& operator=( PermutationArena&& );
+	~PermutationArena();
+};
+
+// ----------------------------------------------------------------------------
+
+inline int PermutationArena::degree() const {
+	return _degree;
+}
+
+inline size_t PermutationArena::size() const {
+	return _size;
+}
+
+inline size_t PermutationArena::stride() const {
+	return _stride;
+}
+
+inline const void* PermutationArena::data() const {
+	return _data;
+}
+
+inline PermutationRef PermutationArena::operator[]( size_t i ) const {
+	return PermutationRef( _data + i * _stride, _degree );
+}
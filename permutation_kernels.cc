@@ -0,0 +1,377 @@
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include "permutation_kernels.h"
+
+#ifdef SIMD_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace {
+	// ------------------------------------------------------------------------
+	// scalar kernels
+
+	template<typename E>
+	void scalar_compose( E* dst, const E* a, const E* b, int n ) {
+		for( int i = 0; i < n; i++ )
+			dst[i] = a[b[i]];
+	}
+
+	template<typename E>
+	void scalar_invert( E* dst, const E* a, int n ) {
+		for( int i = 0; i < n; i++ )
+			dst[ a[i] ] = i;
+	}
+
+	template<typename E>
+	bool scalar_isIdentity( const E* a, int n, int start = 0 ) {
+		for( int i = start; i < n; i++ )
+			if( a[i] != E( i ) )
+				return false;
+		return true;
+	}
+
+	#ifdef SIMD_KERNELS
+	// ------------------------------------------------------------------------
+	// vectorised kernels
+
+	struct cpu_features {
+		bool ssse3;
+		bool avx2;
+		cpu_features() {
+			__builtin_cpu_init();
+			ssse3 = __builtin_cpu_supports( "ssse3" );
+			avx2 = __builtin_cpu_supports( "avx2" );
+		}
+	};
+
+	const cpu_features cpu;
+
+	// composes permutations of degree at most 16 with a single byte shuffle
+	__attribute__((target("ssse3")))
+	void shuffle16_compose( uint8_t* dst, const uint8_t* a, const uint8_t* b, int n ) {
+		alignas(16) uint8_t A[16] = {}, B[16] = {};
+		std::memcpy( A, a, n );
+		std::memcpy( B, b, n );
+		__m128i r = _mm_shuffle_epi8( _mm_load_si128( (const __m128i*) A ), _mm_load_si128( (const __m128i*) B ) );
+		_mm_store_si128( (__m128i*) B, r );
+		std::memcpy( dst, B, n );
+	}
+
+	// shuffles the 32 bytes of table by idx, where all entries of idx are smaller than 32
+	__attribute__((target("avx2")))
+	inline __m256i shuffle32( __m256i lo, __m256i hi, __m256i idx ) {
+		__m256i r_lo = _mm256_shuffle_epi8( lo, idx );
+		__m256i r_hi = _mm256_shuffle_epi8( hi, idx );
+		return _mm256_blendv_epi8( r_lo, r_hi, _mm256_slli_epi16( idx, 3 ) );
+	}
+
+	// composes permutations of degree at most 32 with two byte shuffles
+	__attribute__((target("avx2")))
+	void shuffle32_compose( uint8_t* dst, const uint8_t* a, const uint8_t* b, int n ) {
+		alignas(32) uint8_t A[32] = {}, B[32] = {};
+		std::memcpy( A, a, n );
+		std::memcpy( B, b, n );
+		__m256i table = _mm256_load_si256( (const __m256i*) A );
+		__m256i lo = _mm256_permute2x128_si256( table, table, 0x00 );
+		__m256i hi = _mm256_permute2x128_si256( table, table, 0x11 );
+		_mm256_store_si256( (__m256i*) B, shuffle32( lo, hi, _mm256_load_si256( (const __m256i*) B ) ) );
+		std::memcpy( dst, B, n );
+	}
+
+	// composes with 32-bit gathers, reads up to kernels::padding bytes past the end of a
+	__attribute__((target("avx2")))
+	void gather_compose( uint32_t* dst, const uint32_t* a, const uint32_t* b, int n ) {
+		int i = 0;
+		for( ; i + 8 <= n; i += 8 ) {
+			__m256i idx = _mm256_loadu_si256( (const __m256i*)( b + i ) );
+			_mm256_storeu_si256( (__m256i*)( dst + i ), _mm256_i32gather_epi32( (const int*) a, idx, 4 ) );
+		}
+		scalar_compose( dst + i, a, b + i, n - i );
+	}
+
+	__attribute__((target("avx2")))
+	void gather_compose( uint16_t* dst, const uint16_t* a, const uint16_t* b, int n ) {
+		const __m256i mask = _mm256_set1_epi32( 0xFFFF );
+		int i = 0;
+		for( ; i + 8 <= n; i += 8 ) {
+			__m256i idx = _mm256_cvtepu16_epi32( _mm_loadu_si128( (const __m128i*)( b + i ) ) );
+			__m256i r = _mm256_and_si256( _mm256_i32gather_epi32( (const int*) a, idx, 2 ), mask );
+			r = _mm256_permute4x64_epi64( _mm256_packus_epi32( r, r ), 0x08 );
+			_mm_storeu_si128( (__m128i*)( dst + i ), _mm256_castsi256_si128( r ) );
+		}
+		scalar_compose( dst + i, a, b + i, n - i );
+	}
+
+	__attribute__((target("avx2")))
+	void gather_compose( uint8_t* dst, const uint8_t* a, const uint8_t* b, int n ) {
+		const __m256i mask = _mm256_set1_epi32( 0xFF );
+		int i = 0;
+		for( ; i + 8 <= n; i += 8 ) {
+			__m256i idx = _mm256_cvtepu8_epi32( _mm_loadl_epi64( (const __m128i*)( b + i ) ) );
+			__m256i r = _mm256_and_si256( _mm256_i32gather_epi32( (const int*) a, idx, 1 ), mask );
+			r = _mm256_packus_epi32( r, r );
+			r = _mm256_packus_epi16( r, r );
+			uint32_t lo = _mm256_cvtsi256_si32( r );
+			uint32_t hi = _mm256_extract_epi32( r, 4 );
+			std::memcpy( dst + i, &lo, 4 );
+			std::memcpy( dst + i + 4, &hi, 4 );
+		}
+		scalar_compose( dst + i, a, b + i, n - i );
+	}
+
+	// inverts permutations of degree at most 32 by searching every point with a vector compare
+	__attribute__((target("avx2")))
+	void search32_invert( uint8_t* dst, const uint8_t* a, int n ) {
+		alignas(32) uint8_t A[32];
+		std::memset( A, 0xFF, 32 );
+		std::memcpy( A, a, n );
+		__m256i table = _mm256_load_si256( (const __m256i*) A );
+		for( int j = 0; j < n; j++ ) {
+			uint32_t m = _mm256_movemask_epi8( _mm256_cmpeq_epi8( table, _mm256_set1_epi8( j ) ) );
+			dst[j] = __builtin_ctz( m );
+		}
+	}
+
+	// returns the vector (s,s+d,s+2d,...) of images of type E
+	template<typename E>
+	__attribute__((target("avx2")))
+	inline __m256i ramp( int s, int d ) {
+		alignas(32) E v[32 / sizeof(E)];
+		for( size_t i = 0; i < 32 / sizeof(E); i++ )
+			v[i] = E( s + d * i );
+		return _mm256_load_si256( (const __m256i*) v );
+	}
+
+	template<typename E>
+	__attribute__((target("avx2")))
+	inline __m256i add( __m256i x, __m256i y ) {
+		switch( sizeof(E) ) {
+			case 1:
+				return _mm256_add_epi8( x, y );
+			case 2:
+				return _mm256_add_epi16( x, y );
+			default:
+				return _mm256_add_epi32( x, y );
+		}
+	}
+
+	template<typename E>
+	__attribute__((target("avx2")))
+	bool vector_isIdentity( const E* a, int n ) {
+		const int k = 32 / sizeof(E);
+		const __m256i inc = ramp<E>( k, 0 );
+		__m256i id = ramp<E>( 0, 1 );
+		int i = 0;
+		for( ; i + k <= n; i += k ) {
+			__m256i x = _mm256_loadu_si256( (const __m256i*)( a + i ) );
+			if( _mm256_movemask_epi8( _mm256_cmpeq_epi8( x, id ) ) != -1 )
+				return false;
+			id = add<E>( id, inc );
+		}
+		return scalar_isIdentity( a, n, i );
+	}
+
+	__attribute__((target("avx2")))
+	bool vector_equal( const uint8_t* a, const uint8_t* b, size_t bytes ) {
+		size_t i = 0;
+		for( ; i + 32 <= bytes; i += 32 ) {
+			__m256i x = _mm256_loadu_si256( (const __m256i*)( a + i ) );
+			__m256i y = _mm256_loadu_si256( (const __m256i*)( b + i ) );
+			if( _mm256_movemask_epi8( _mm256_cmpeq_epi8( x, y ) ) != -1 )
+				return false;
+		}
+		return std::memcmp( a + i, b + i, bytes - i ) == 0;
+	}
+	#endif
+
+	// ------------------------------------------------------------------------
+	// dispatch
+
+	template<typename E>
+	void compose( E* dst, const E* a, const E* b, int n ) {
+		#ifdef SIMD_KERNELS
+		if( cpu.avx2 and n >= 16 ) {
+			gather_compose( dst, a, b, n );
+			return;
+		}
+		#endif
+		scalar_compose( dst, a, b, n );
+	}
+
+	void compose( uint8_t* dst, const uint8_t* a, const uint8_t* b, int n ) {
+		#ifdef SIMD_KERNELS
+		if( n <= 16 and cpu.ssse3 ) {
+			shuffle16_compose( dst, a, b, n );
+			return;
+		} else if( n <= 32 and cpu.avx2 ) {
+			shuffle32_compose( dst, a, b, n );
+			return;
+		}
+		#endif
+		compose<uint8_t>( dst, a, b, n );
+	}
+
+	template<typename E>
+	void composeBatch( E* const* dst, const E* const* a, const E* b, int n, size_t count ) {
+		for( size_t k = 0; k < count; k++ )
+			compose( dst[k], a[k], b, n );
+	}
+
+	template<typename E>
+	void composeBatch( E* const* dst, const E* a, const E* const* b, int n, size_t count ) {
+		for( size_t k = 0; k < count; k++ )
+			compose( dst[k], a, b[k], n );
+	}
+
+	#ifdef SIMD_KERNELS
+	// left multiplication by a fixed permutation of degree at most 32 loads the table once
+	__attribute__((target("avx2")))
+	void shuffle32_composeBatch( uint8_t* const* dst, const uint8_t* a, const uint8_t* const* b, int n, size_t count ) {
+		alignas(32) uint8_t A[32] = {}, B[32] = {};
+		std::memcpy( A, a, n );
+		__m256i table = _mm256_load_si256( (const __m256i*) A );
+		__m256i lo = _mm256_permute2x128_si256( table, table, 0x00 );
+		__m256i hi = _mm256_permute2x128_si256( table, table, 0x11 );
+		for( size_t k = 0; k < count; k++ ) {
+			std::memcpy( B, b[k], n );
+			_mm256_store_si256( (__m256i*) B, shuffle32( lo, hi, _mm256_load_si256( (const __m256i*) B ) ) );
+			std::memcpy( dst[k], B, n );
+		}
+	}
+
+	// right multiplication by a fixed permutation of degree at most 32 loads the indices once
+	__attribute__((target("avx2")))
+	void shuffle32_composeBatch( uint8_t* const* dst, const uint8_t* const* a, const uint8_t* b, int n, size_t count ) {
+		alignas(32) uint8_t A[32] = {}, B[32] = {};
+		std::memcpy( B, b, n );
+		__m256i idx = _mm256_load_si256( (const __m256i*) B );
+		for( size_t k = 0; k < count; k++ ) {
+			std::memcpy( A, a[k], n );
+			__m256i table = _mm256_load_si256( (const __m256i*) A );
+			__m256i lo = _mm256_permute2x128_si256( table, table, 0x00 );
+			__m256i hi = _mm256_permute2x128_si256( table, table, 0x11 );
+			_mm256_store_si256( (__m256i*) A, shuffle32( lo, hi, idx ) );
+			std::memcpy( dst[k], A, n );
+		}
+	}
+	#endif
+
+	void composeBatch( uint8_t* const* dst, const uint8_t* const* a, const uint8_t* b, int n, size_t count ) {
+		#ifdef SIMD_KERNELS
+		if( n <= 32 and cpu.avx2 ) {
+			shuffle32_composeBatch( dst, a, b, n, count );
+			return;
+		}
+		#endif
+		composeBatch<uint8_t>( dst, a, b, n, count );
+	}
+
+	void composeBatch( uint8_t* const* dst, const uint8_t* a, const uint8_t* const* b, int n, size_t count ) {
+		#ifdef SIMD_KERNELS
+		if( n <= 32 and cpu.avx2 ) {
+			shuffle32_composeBatch( dst, a, b, n, count );
+			return;
+		}
+		#endif
+		composeBatch<uint8_t>( dst, a, b, n, count );
+	}
+
+	template<typename E>
+	void invert( E* dst, const E* a, int n ) {
+		scalar_invert( dst, a, n );
+	}
+
+	void invert( uint8_t* dst, const uint8_t* a, int n ) {
+		#ifdef SIMD_KERNELS
+		if( n <= 32 and cpu.avx2 ) {
+			search32_invert( dst, a, n );
+			return;
+		}
+		#endif
+		scalar_invert( dst, a, n );
+	}
+
+	template<typename E>
+	bool isIdentity( const E* a, int n ) {
+		#ifdef SIMD_KERNELS
+		if( cpu.avx2 )
+			return vector_isIdentity( a, n );
+		#endif
+		return scalar_isIdentity( a, n );
+	}
+}
+
+namespace kernels {
+	void compose( int w, void* dst, const void* a, const void* b, int n ) {
+		switch( w ) {
+			case 1:
+				return ::compose( (uint8_t*) dst, (const uint8_t*) a, (const uint8_t*) b, n );
+			case 2:
+				return ::compose( (uint16_t*) dst, (const uint16_t*) a, (const uint16_t*) b, n );
+			default:
+				return ::compose( (uint32_t*) dst, (const uint32_t*) a, (const uint32_t*) b, n );
+		}
+	}
+
+	void composeBatch( int w, void* const* dst, const void* const* a, const void* b, int n, size_t count ) {
+		switch( w ) {
+			case 1:
+				return ::composeBatch( (uint8_t* const*) dst, (const uint8_t* const*) a, (const uint8_t*) b, n, count );
+			case 2:
+				return ::composeBatch( (uint16_t* const*) dst, (const uint16_t* const*) a, (const uint16_t*) b, n, count );
+			default:
+				return ::composeBatch( (uint32_t* const*) dst, (const uint32_t* const*) a, (const uint32_t*) b, n, count );
+		}
+	}
+
+	void composeBatch( int w, void* const* dst, const void* a, const void* const* b, int n, size_t count ) {
+		switch( w ) {
+			case 1:
+				return ::composeBatch( (uint8_t* const*) dst, (const uint8_t*) a, (const uint8_t* const*) b, n, count );
+			case 2:
+				return ::composeBatch( (uint16_t* const*) dst, (const uint16_t*) a, (const uint16_t* const*) b, n, count );
+			default:
+				return ::composeBatch( (uint32_t* const*) dst, (const uint32_t*) a, (const uint32_t* const*) b, n, count );
+		}
+	}
+
+	void invert( int w, void* dst, const void* a, int n ) {
+		switch( w ) {
+			case 1:
+				return ::invert( (uint8_t*) dst, (const uint8_t*) a, n );
+			case 2:
+				return ::invert( (uint16_t*) dst, (const uint16_t*) a, n );
+			default:
+				return ::invert( (uint32_t*) dst, (const uint32_t*) a, n );
+		}
+	}
+
+	bool isIdentity( int w, const void* a, int n ) {
+		switch( w ) {
+			case 1:
+				return ::isIdentity( (const uint8_t*) a, n );
+			case 2:
+				return ::isIdentity( (const uint16_t*) a, n );
+			default:
+				return ::isIdentity( (const uint32_t*) a, n );
+		}
+	}
+
+	bool equal( int w, const void* a, const void* b, int n ) {
+		#ifdef SIMD_KERNELS
+		if( cpu.avx2 )
+			return vector_equal( (const uint8_t*) a, (const uint8_t*) b, size_t( n ) * w );
+		#endif
+		return std::memcmp( a, b, size_t( n ) * w ) == 0;
+	}
+
+	bool vectorised() {
+		#ifdef SIMD_KERNELS
+		return cpu.avx2;
+		#else
+		return false;
+		#endif
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+/********************************************************
+This file contains the low level kernels acting on the
+images of permutations. All kernels take the width in
+bytes of a single image (1, 2 or 4) and the degree n.
+On x86 vectorised versions are selected at runtime and
+the scalar versions are used as fallback.
+********************************************************/
+
+// toggle for vectorised kernels
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#define SIMD_KERNELS
+#endif
+
+#include <cstddef>
+
+namespace kernels {
+	// number of bytes past the end of an image array that the kernels may read
+	const int padding = 4;
+
+	// sets dst[i] = a[b[i]], dst may alias b but not a
+	void compose( int w, void* dst, const void* a, const void* b, int n );
+
+	// sets dst[k][i] = a[k][b[i]] for all k < count
+	void composeBatch( int w, void* const* dst, const void* const* a, const void* b, int n, size_t count );
+
+	// sets dst[k][i] = a[b[k][i]] for all k < count
+	void composeBatch( int w, void* const* dst, const void* a, const void* const* b, int n, size_t count );
+
+	// sets dst[a[i]] = i, dst may not alias a
+	void invert( int w, void* dst, const void* a, int n );
+
+	// checks whether a[i] = i for all i
+	bool isIdentity( int w, const void* a, int n );
+
+	// checks whether a[i] = b[i] for all i
+	bool equal( int w, const void* a, const void* b, int n );
+
+	// checks whether the vectorised kernels are used on this machine
+	bool vectorised();
+}
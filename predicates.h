@@ -0,0 +1,178 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <cstdint>
+
+#include "permutation.h"
+#include "group.h"
+#include "stabilizer_chain.h"
+
+// predicates describing subgroups, for Subgroup and SubgroupGenerator
+// *************************************************************
+// A predicate is anything callable as bool( const Permutation& )
+// that returns whether a permutation lies in the subgroup it
+// describes. The generator is instantiated for the type of the
+// predicate, so these calls are direct. The predicates below
+// also provide invariant( sigma ), a value that is constant on
+// the left cosets of their subgroup; the generator recognizes
+// the member and only compares a permutation with the coset
+// representatives that have the same invariant. Most of them
+// also provide subgroupOf( G ), the subgroup of G they describe
+// computed from their structure: from a stabilizer chain whose
+// base starts with the fixed point, or by a backtrack search
+// whose base starts with the stabilised set. Subgroup takes it
+// instead of running the closure, and the generator fills its
+// table with it, so its closure only finds coset representatives.
+// *************************************************************
+
+// permutations fixing the point x
+class PointStabilizerPredicate {
+	int _x;
+public:
+	bool operator()( const Permutation& sigma ) const;
+
+	// the image of x
+	uint64_t invariant( const Permutation& sigma ) const;
+
+	// the stabiliser of x in G, read off a stabilizer chain of G whose base starts with x
+	Group subgroupOf( Group G ) const;
+
+	PointStabilizerPredicate( int x );
+};
+
+// permutations fixing a set of points setwise
+class SetStabilizerPredicate {
+	std::vector<int> _points;
+	std::vector<char> _member;
+public:
+	bool operator()( const Permutation& sigma ) const;
+
+	// a hash of the image of the set, independent of the order of its points
+	uint64_t invariant( const Permutation& sigma ) const;
+
+	// the setwise stabiliser in G, by a backtrack search whose base starts with the points
+	Group subgroupOf( Group G ) const;
+
+	// constructs the predicate for a set of points of {0,...,n-1}
+	SetStabilizerPredicate( int n, const std::vector<int>& points );
+};
+
+// permutations acting trivially in an action, see Action::kernel
+// the action must outlive the predicate, and the kernel itself is computed by Action::calculateKernel
+template<typename A, typename value_type>
+class ActionKernelPredicate {
+	const A* _action;
+	std::vector<value_type> _domain;
+	std::shared_ptr<const std::map<value_type,int>> _index;
+public:
+	bool operator()( const Permutation& sigma ) const;
+
+	// a hash of the images of the domain; sigma and sigma * h act the same for h in the kernel
+	uint64_t invariant( const Permutation& sigma ) const;
+
+	ActionKernelPredicate( const A& action );
+};
+
+// elements of another group H
+class MembershipPredicate {
+	Group _H;
+	std::shared_ptr<const StabilizerChain> _chain;
+public:
+	bool operator()( const Permutation& sigma ) const;
+
+	// a hash of the least base image under H, see StabilizerChain::minimalCosetImage
+	uint64_t invariant( const Permutation& sigma ) const;
+
+	// the intersection of G with H, which is H itself when G contains it
+	Group subgroupOf( Group G ) const;
+
+	MembershipPredicate( Group H );
+};
+
+// ----------------------------------------------------------------
+
+inline bool PointStabilizerPredicate::operator()( const Permutation& sigma ) const {
+	return sigma( _x ) == _x;
+}
+
+inline uint64_t PointStabilizerPredicate::invariant( const Permutation& sigma ) const {
+	return sigma( _x );
+}
+
+inline Group PointStabilizerPredicate::subgroupOf( Group G ) const {
+	return G->stabilizer( _x );
+}
+
+inline PointStabilizerPredicate::PointStabilizerPredicate( int x ) : _x( x ) {
+}
+
+inline bool SetStabilizerPredicate::operator()( const Permutation& sigma ) const {
+	for( int x : _points )
+		if( not _member[ sigma( x ) ] )
+			return false;
+	return true;
+}
+
+inline uint64_t SetStabilizerPredicate::invariant( const Permutation& sigma ) const {
+	uint64_t h = 0;
+	for( int x : _points ) {
+		uint64_t y = uint64_t( sigma( x ) ) * 0x9e3779b97f4a7c15ULL;
+		h += y ^ ( y >> 31 );
+	}
+	return h;
+}
+
+inline Group SetStabilizerPredicate::subgroupOf( Group G ) const {
+	return G->setStabilizer( _points );
+}
+
+inline SetStabilizerPredicate::SetStabilizerPredicate( int n, const std::vector<int>& points ) : _points( points ), _member( n, false ) {
+	for( int x : points )
+		_member[x] = true;
+}
+
+template<typename A, typename value_type>
+bool ActionKernelPredicate<A,value_type>::operator()( const Permutation& sigma ) const {
+	for( const auto& x : _domain )
+		if( (*_action)( sigma, x ) != x )
+			return false;
+	return true;
+}
+
+template<typename A, typename value_type>
+uint64_t ActionKernelPredicate<A,value_type>::invariant( const Permutation& sigma ) const {
+	uint64_t h = 0;
+	for( const auto& x : _domain )
+		h = ( h ^ _index->at( (*_action)( sigma, x ) ) ) * 0x100000001b3ULL;
+	return h;
+}
+
+template<typename A, typename value_type>
+ActionKernelPredicate<A,value_type>::ActionKernelPredicate( const A& action ) : _action( &action ) {
+	const auto& d = action.domain();
+	_domain.assign( d.begin(), d.end() );
+	auto index = std::make_shared<std::map<value_type,int>>();
+	for( const auto& x : _domain )
+		index->emplace( x, index->size() );
+	_index = index;
+}
+
+inline bool MembershipPredicate::operator()( const Permutation& sigma ) const {
+	return _H->contains( sigma );
+}
+
+inline uint64_t MembershipPredicate::invariant( const Permutation& sigma ) const {
+	uint64_t h = 0;
+	for( int x : _chain->minimalCosetImage( sigma ) )
+		h = ( h ^ uint64_t( x ) ) * 0x100000001b3ULL;
+	return h;
+}
+
+inline Group MembershipPredicate::subgroupOf( Group G ) const {
+	return G->hasSubgroup( _H ) ? _H : G->intersection( _H );
+}
+
+inline MembershipPredicate::MembershipPredicate( Group H ) : _H( H ), _chain( H->chainWithBase( {}, false ) ) {
+}
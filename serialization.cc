@@ -0,0 +1,133 @@
+#include <stdexcept>
+#include <cstdlib>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "serialization.h"
+
+const char* MappedFile::data() const {
+	return _data;
+}
+
+size_t MappedFile::size() const {
+	return _size;
+}
+
+MappedFile::MappedFile( const std::string& path ) : _data( nullptr ), _size( 0 ), _mapped( false ) {
+#ifdef __linux__
+	int fd = open( path.c_str(), O_RDONLY );
+	if( fd < 0 )
+		throw std::runtime_error( "Can't open " + path );
+	struct stat st;
+	if( fstat( fd, &st ) == 0 and st.st_size > 0 ) {
+		void* p = mmap( nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+		if( p != MAP_FAILED ) {
+			_data = static_cast<const char*>( p );
+			_size = st.st_size;
+			_mapped = true;
+		}
+	}
+	::close( fd );
+	if( _mapped )
+		return;
+#endif
+	// without mmap the file is read into an aligned buffer
+	std::ifstream in( path, std::ios::binary | std::ios::ate );
+	if( not in )
+		throw std::runtime_error( "Can't open " + path );
+	_size = in.tellg();
+	char* buffer = static_cast<char*>( aligned_alloc( PermutationArena::alignment, ( _size + PermutationArena::alignment ) / PermutationArena::alignment * PermutationArena::alignment ) );
+	in.seekg( 0 );
+	in.read( buffer, _size );
+	_data = buffer;
+}
+
+MappedFile::~MappedFile() {
+#ifdef __linux__
+	if( _mapped ) {
+		munmap( const_cast<char*>( _data ), _size );
+		return;
+	}
+#endif
+	std::free( const_cast<char*>( _data ) );
+}
+
+// ----------------------------------------------------------------------------
+
+const uint32_t BinaryWriter::version;
+const uint64_t BinaryWriter::magic;
+
+void BinaryWriter::raw( const void* data, size_t bytes ) {
+	_out.write( static_cast<const char*>( data ), bytes );
+	_offset += bytes;
+}
+
+void BinaryWriter::align() {
+	static const char zeros[PermutationArena::alignment] = {};
+	raw( zeros, ( PermutationArena::alignment - _offset % PermutationArena::alignment ) % PermutationArena::alignment );
+}
+
+void BinaryWriter::write( const PermutationArena& arena ) {
+	write<int32_t>( arena.degree() );
+	write<uint64_t>( arena.size() );
+	write<uint64_t>( arena.stride() );
+	align();
+	raw( arena.data(), arena.size() * arena.stride() );
+}
+
+BinaryWriter::BinaryWriter( const std::string& path, StructureKind kind ) : _out( path, std::ios::binary | std::ios::trunc ), _offset( 0 ) {
+	if( not _out )
+		throw std::runtime_error( "Can't create " + path );
+	write( magic );
+	write( version );
+	write( kind );
+}
+
+void BinaryWriter::close() {
+	_out.close();
+	if( _out.fail() )
+		throw std::runtime_error( "Writing structure failed" );
+}
+
+// ----------------------------------------------------------------------------
+
+const char* BinaryReader::raw( size_t bytes ) {
+	if( bytes > _file->size() - _offset )
+		throw std::runtime_error( "Structure file is truncated" );
+	const char* p = _file->data() + _offset;
+	_offset += bytes;
+	return p;
+}
+
+void BinaryReader::align() {
+	raw( ( PermutationArena::alignment - _offset % PermutationArena::alignment ) % PermutationArena::alignment );
+}
+
+void BinaryReader::read( PermutationArena& arena ) {
+	int n = read<int32_t>();
+	size_t count = read<uint64_t>();
+	size_t stride = read<uint64_t>();
+	align();
+	PermutationArena probe( n );
+	if( stride != probe.stride() )
+		throw std::runtime_error( "Structure file has a different permutation layout" );
+	const char* p = raw( count * stride );
+	if( count == 0 )
+		arena.reset( n );
+	else
+		arena.attach( p, count, n, _file );
+}
+
+BinaryReader::BinaryReader( const std::string& path, StructureKind kind ) : _file( std::make_shared<MappedFile>( path ) ), _offset( 0 ) {
+	if( read<uint64_t>() != BinaryWriter::magic )
+		throw std::runtime_error( path + " is not a structure file" );
+	if( read<uint32_t>() != BinaryWriter::version )
+		throw std::runtime_error( path + " has an unsupported version" );
+	if( read<StructureKind>() != kind )
+		throw std::runtime_error( path + " holds another kind of structure" );
+}
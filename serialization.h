@@ -0,0 +1,124 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+
+#include "permutation_arena.h"
+
+// kinds of structure stored in a file
+enum class StructureKind : uint32_t {
+	fhl = 1,
+	stabilizer_chain = 2,
+	subgroup = 3
+};
+
+// read-only memory mapping of a whole file
+class MappedFile {
+	const char* _data;
+	size_t _size;
+	bool _mapped;
+public:
+	// returns the contents of the file
+	const char* data() const;
+	size_t size() const;
+
+	// maps the file at path, throws std::runtime_error when it cannot be opened
+	MappedFile( const std::string& path );
+	MappedFile( const MappedFile& ) = delete;
+	MappedFile& operator=( const MappedFile& ) = delete;
+	~MappedFile();
+};
+
+// binary format of stored structures
+// *************************************************************
+// A file starts with a header holding a magic number, the format
+// version and the kind of structure, followed by its fields in
+// the order in which the structure writes them. Integers are
+// stored in the byte order of the machine; a file written on a
+// machine with another byte order fails the magic number check.
+// Permutation arenas start at multiples of 64 bytes and are
+// stored exactly as in memory, so a reader attaches them to the
+// mapped file instead of copying them: loading a large structure
+// costs little more than mapping the file.
+// *************************************************************
+class BinaryWriter {
+	std::ofstream _out;
+	uint64_t _offset;
+
+	void raw( const void* data, size_t bytes );
+	void align();
+public:
+	// version written to and required in the header
+	static const uint32_t version = 1;
+	static const uint64_t magic = 0x5349424752414e42ULL; // "BNARGBIS"
+
+	// writes a fixed size value
+	template<typename V> void write( const V& value );
+
+	// writes a vector of fixed size values, preceded by its length
+	template<typename V> void write( const std::vector<V>& values );
+
+	// writes the permutations of an arena in place
+	void write( const PermutationArena& arena );
+
+	// creates the file at path and writes the header, throws std::runtime_error on failure
+	BinaryWriter( const std::string& path, StructureKind kind );
+
+	// flushes the file, throws std::runtime_error when writing failed
+	void close();
+};
+
+// reader of the format written by BinaryWriter
+class BinaryReader {
+	std::shared_ptr<const MappedFile> _file;
+	uint64_t _offset;
+
+	const char* raw( size_t bytes );
+	void align();
+public:
+	// reads a fixed size value
+	template<typename V> V read();
+
+	// reads a vector of fixed size values
+	template<typename V> std::vector<V> readVector();
+
+	// attaches an arena to the permutations stored in the file
+	void read( PermutationArena& arena );
+
+	// maps the file at path and checks its header
+	// throws std::runtime_error when it is not a structure of this kind and version
+	BinaryReader( const std::string& path, StructureKind kind );
+};
+
+// ----------------------------------------------------------------------------
+
+template<typename V>
+void BinaryWriter::write( const V& value ) {
+	raw( &value, sizeof( V ) );
+}
+
+template<typename V>
+void BinaryWriter::write( const std::vector<V>& values ) {
+	write<uint64_t>( values.size() );
+	raw( values.data(), values.size() * sizeof( V ) );
+}
+
+template<typename V>
+V BinaryReader::read() {
+	V value;
+	std::memcpy( &value, raw( sizeof( V ) ), sizeof( V ) );
+	return value;
+}
+
+template<typename V>
+std::vector<V> BinaryReader::readVector() {
+	size_t count = read<uint64_t>();
+	const char* p = raw( count * sizeof( V ) );
+	std::vector<V> values( count );
+	std::memcpy( values.data(), p, count * sizeof( V ) );
+	return values;
+}
@@ -0,0 +1,814 @@
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+#include "stabilizer_chain.h"
+#include "unionfind.h"
+
+const Permutation& ProductReplacement::next() {
+	size_t r = slots.size();
+	size_t i = rng() % r;
+	size_t j = rng() % ( r - 1 );
+	if( j >= i )
+		++j;
+	uint64_t bits = rng();
+	if( bits & 1 ) {
+		slots[j].invertInto( scratch );
+		if( bits & 2 )
+			Permutation::composeInto( slots[i], slots[i], scratch );
+		else
+			slots[i].leftMultiplyInPlace( scratch );
+	} else if( bits & 2 )
+		Permutation::composeInto( slots[i], slots[i], slots[j] );
+	else
+		slots[i].leftMultiplyInPlace( slots[j] );
+	Permutation::composeInto( accumulator, accumulator, slots[i] );
+	return accumulator;
+}
+
+ProductReplacement::ProductReplacement( const std::vector<Permutation>& S, uint64_t seed ) : accumulator( S.front().degree() ), scratch( 0 ), rng( seed ) {
+	size_t r = std::max<size_t>( 10, S.size() );
+	slots.reserve( r );
+	for( size_t i = 0; i < r; ++i )
+		slots.push_back( S[ i % S.size() ] );
+	for( int k = 0; k < warm_up; ++k )
+		next();
+}
+
+// ----------------------------------------------------------------------------
+
+StabilizerChainOptions& StabilizerChain::defaults() {
+	static StabilizerChainOptions options;
+	return options;
+}
+
+void StabilizerChain::clear() {
+	n = 0;
+	L.clear();
+	S.reset( 0 );
+	Sinv.reset( 0 );
+}
+
+void StabilizerChain::addBasePoint( int b ) {
+	L.emplace_back();
+	level& l = L.back();
+	l.point = b;
+	l.schreier.assign( n, -1 );
+	l.schreier[b] = -2;
+	l.orbit.push_back( b );
+	l.checked_points = 0;
+	l.checked_generators = 0;
+}
+
+void StabilizerChain::choosePriority( const std::vector<Permutation>& generators, const StabilizerChainOptions& options ) {
+	priority.clear();
+	priority.reserve( n );
+	if( options.base_strategy == BaseStrategy::largest_orbit ) {
+		UnionFind U( n );
+		for( const Permutation& sigma : generators )
+			for( int x = 0; x < n; ++x )
+				U.cup( x, sigma( x ) );
+		auto orbits = U.partitioning<std::vector<std::vector<int>>>();
+		std::stable_sort( orbits.begin(), orbits.end(), []( const std::vector<int>& a, const std::vector<int>& b ) {
+			return a.size() > b.size();
+		} );
+		for( const auto& O : orbits )
+			priority.insert( priority.end(), O.begin(), O.end() );
+	} else {
+		std::vector<bool> listed( n, false );
+		if( options.base_strategy == BaseStrategy::given_order ) {
+			for( int x : options.base_order ) {
+				if( not listed[x] )
+					priority.push_back( x );
+				listed[x] = true;
+			}
+		}
+		for( int x = 0; x < n; ++x )
+			if( not listed[x] )
+				priority.push_back( x );
+	}
+}
+
+void StabilizerChain::addBasePointMovedBy( const Permutation& sigma ) {
+	for( int b : priority ) {
+		if( sigma( b ) != b ) {
+			addBasePoint( b );
+			return;
+		}
+	}
+}
+
+void StabilizerChain::changeBase( const std::vector<int>& prefix ) {
+	if( not arrangeBase( prefix, base() ) )
+		rebuild( prefix );
+}
+
+void StabilizerChain::changeBase( const std::vector<int>& prefix, const StabilizerChainOptions& strategy ) {
+	choosePriority( listGenerators(), strategy );
+	if( not arrangeBase( prefix, priority ) )
+		rebuild( prefix );
+}
+
+void StabilizerChain::rebuild( const std::vector<int>& prefix ) {
+	// random sifting usually reaches the order quickly; when it stalls, the deterministic closure finishes
+	// the chain, so this terminates even when the chain was an incomplete Monte Carlo one
+	StabilizerChainOptions options;
+	options.randomized = true;
+	options.verify = true;
+	options.order = exactOrder();
+	options.base_strategy = BaseStrategy::given_order;
+	options.base_order = priority;
+	create( listGenerators(), n, prefix, options );
+}
+
+bool StabilizerChain::arrangeBase( const std::vector<int>& prefix, const std::vector<int>& candidates ) {
+	std::vector<bool> placed( n, false );
+	size_t p = 0;
+	// moves b to level p, below the points placed so far
+	auto place = [&]( int b ) -> bool {
+		size_t q = p;
+		while( q < L.size() and L[q].point != b )
+			++q;
+		if( q == L.size() )
+			addBasePoint( b );
+		for( ; q > p; --q )
+			if( not swapBasePoints( q - 1 ) )
+				return false;
+		placed[b] = true;
+		++p;
+		return true;
+	};
+	for( int b : prefix )
+		if( not placed[b] and not place( b ) )
+			return false;
+	for( int c : candidates ) {
+		if( p == L.size() )
+			break;
+		if( placed[c] )
+			continue;
+		// c is a base point when the stabiliser of the points placed so far moves it
+		bool moved = false;
+		for( int g : L[p].generators )
+			moved = moved or S[g]( c ) != c;
+		if( moved and not place( c ) )
+			return false;
+	}
+	// the candidates include a base, so the stabiliser of the placed points is trivial in a complete chain and the
+	// levels after them are redundant
+	for( size_t i = L.size(); i-- > p; )
+		if( L[i].orbit.size() == 1 )
+			L.erase( L.begin() + i );
+	return true;
+}
+
+bool StabilizerChain::swapBasePoints( size_t i ) {
+	int x = L[i].point, y = L[i + 1].point;
+	// the first new level has the group of level i, acting on the orbit of y
+	level upper;
+	upper.point = y;
+	upper.generators = L[i].generators;
+	upper.schreier.assign( n, -1 );
+	upper.schreier[y] = -2;
+	upper.orbit.push_back( y );
+	upper.checked_points = upper.checked_generators = 0;
+	extendOrbit( upper, 0 );
+	// the second new level has its stabiliser of y, acting on the orbit of x, whose size then follows from the order
+	size_t target = L[i].orbit.size() * L[i + 1].orbit.size() / upper.orbit.size();
+	// the generators of level i+2 fix both points
+	const std::vector<int> fixing = i + 2 < L.size() ? L[i + 2].generators : std::vector<int>();
+	level lower;
+	lower.point = x;
+	lower.generators = fixing;
+	lower.schreier.assign( n, -1 );
+	lower.schreier[x] = -2;
+	lower.orbit.push_back( x );
+	lower.checked_points = lower.checked_generators = 0;
+	extendOrbit( lower, 0 );
+	// the elements of level i mapping x to gamma are u * h with h in level i+1, and one of them fixes y
+	// exactly when u^-1( y ) lies in the orbit of level i+1; otherwise neither do the elements mapping x
+	// into the orbit of gamma under the stabiliser of x and y
+	std::vector<char> excluded( n, 0 );
+	Permutation u( 0 ), v( 0 ), w( 0 );
+	for( size_t k = 0; k < L[i].orbit.size() and lower.orbit.size() < target; ++k ) {
+		int gamma = L[i].orbit[k];
+		if( excluded[gamma] or lower.schreier[gamma] != -1 )
+			continue;
+		transversal( i, gamma, u );
+		u.invertInto( w );
+		int z = w( y );
+		if( L[i + 1].schreier[z] != -1 ) {
+			transversal( i + 1, z, v );
+			Permutation::composeInto( w, u, v );
+			lower.generators.push_back( S.push( w ) );
+			Sinv.pushInverse( w );
+			extendOrbit( lower, lower.generators.size() - 1 );
+		} else {
+			std::vector<int> orbit( 1, gamma );
+			excluded[gamma] = 1;
+			for( size_t l = 0; l < orbit.size(); ++l )
+				for( int g : fixing ) {
+					int delta = S[g]( orbit[l] );
+					if( not excluded[delta] ) {
+						excluded[delta] = 1;
+						orbit.push_back( delta );
+					}
+				}
+		}
+	}
+	if( lower.orbit.size() * upper.orbit.size() < L[i].orbit.size() * L[i + 1].orbit.size() )
+		return false;
+	L[i] = std::move( upper );
+	L[i + 1] = std::move( lower );
+	return true;
+}
+
+void StabilizerChain::addGenerator( const Permutation& sigma, size_t first, size_t last ) {
+	int slot = S.push( sigma );
+	Sinv.pushInverse( sigma );
+	for( size_t i = first; i <= last; ++i ) {
+		L[i].generators.push_back( slot );
+		extendOrbit( L[i], L[i].generators.size() - 1 );
+	}
+}
+
+void StabilizerChain::extendOrbit( level& l, size_t first ) const {
+	size_t old = l.orbit.size();
+	for( size_t k = 0; k < l.orbit.size(); ++k ) {
+		int y = l.orbit[k];
+		// old points were already closed under the old generators
+		for( size_t t = k < old ? first : 0; t < l.generators.size(); ++t ) {
+			int g = l.generators[t];
+			int x = S[g]( y );
+			if( l.schreier[x] == -1 ) {
+				l.schreier[x] = g;
+				l.orbit.push_back( x );
+			}
+		}
+	}
+}
+
+void StabilizerChain::transversal( size_t i, int x, Permutation& u ) const {
+	const level& l = L[i];
+	u = Permutation( n );
+	for( int g = l.schreier[x]; g != -2; g = l.schreier[x] ) {
+		Permutation::composeInto( u, u, S[g] );
+		x = Sinv[g]( x );
+	}
+}
+
+size_t StabilizerChain::sift( Permutation& sigma, size_t first ) const {
+	for( size_t i = first; i < L.size(); ++i ) {
+		const level& l = L[i];
+		int x = sigma( l.point );
+		if( l.schreier[x] == -1 )
+			return i;
+		for( int g = l.schreier[x]; g != -2; g = l.schreier[x] ) {
+			sigma.leftMultiplyInPlace( Sinv[g] );
+			x = Sinv[g]( x );
+		}
+	}
+	return L.size();
+}
+
+std::vector<char> StabilizerChain::siftAll( const std::vector<Permutation>& P, size_t begin, size_t end, bool stop ) const {
+	std::vector<char> member( end - begin, 0 );
+	std::vector<Permutation> W;
+	std::vector<size_t> alive, next;
+	W.reserve( end - begin );
+	for( size_t k = begin; k < end; ++k ) {
+		if( P[k].degree() != n ) {
+			if( stop )
+				return member;
+			W.emplace_back( 0 );
+			continue;
+		}
+		alive.push_back( W.size() );
+		W.push_back( P[k] );
+	}
+	for( const level& l : L ) {
+		next.clear();
+		for( size_t k : alive ) {
+			Permutation& sigma = W[k];
+			int x = sigma( l.point );
+			if( l.schreier[x] == -1 ) {
+				if( stop )
+					return member;
+				continue;
+			}
+			for( int g = l.schreier[x]; g != -2; g = l.schreier[x] ) {
+				sigma.leftMultiplyInPlace( Sinv[g] );
+				x = Sinv[g]( x );
+			}
+			next.push_back( k );
+		}
+		std::swap( alive, next );
+	}
+	for( size_t k : alive ) {
+		if( not W[k].isIdentity() and stop )
+			return std::vector<char>( end - begin, 0 );
+		member[k] = W[k].isIdentity();
+	}
+	return member;
+}
+
+size_t StabilizerChain::firstNonTrivial( size_t i, const std::vector<std::pair<size_t,size_t>>& pairs, size_t begin, size_t end, Permutation& h, size_t& j ) const {
+	Permutation u( 0 );
+	for( size_t q = begin; q < end; ++q ) {
+		size_t k = pairs[q].first;
+		if( q == begin or k != pairs[q-1].first )
+			transversal( i, L[i].orbit[k], u );
+		Permutation::composeInto( h, S[L[i].generators[pairs[q].second]], u );
+		j = sift( h, i );
+		if( j < L.size() or not h.isIdentity() )
+			return q;
+	}
+	return end;
+}
+
+void StabilizerChain::close( bool parallel, const natural& bound ) {
+	// residue of the first Schreier generator of a range that does not sift to the identity
+	struct failure {
+		size_t index;
+		size_t level;
+		Permutation residue = Permutation( 0 );
+	};
+	Permutation h( 0 );
+	std::vector<std::pair<size_t,size_t>> pairs;
+	// levels above i are complete, i.e. every Schreier generator of them sifts to the identity
+	for( size_t i = L.size(); i-- > 0; ) {
+		// the Schreier generators of level i that were not checked yet, as (orbit point, generator)
+		pairs.clear();
+		for( size_t k = 0; k < L[i].orbit.size(); ++k )
+			for( size_t t = k < L[i].checked_points ? L[i].checked_generators : 0; t < L[i].generators.size(); ++t )
+				pairs.emplace_back( k, t );
+		size_t found = pairs.size();
+		size_t j = 0;
+		if( parallel ) {
+			// the chunks are checked concurrently, the first failure in order wins as in the serial
+			// algorithm and later ones are checked again after the chain has been extended
+			for( size_t begin = 0; begin < pairs.size() and found == pairs.size(); begin += batch_size ) {
+				size_t end = std::min( begin + batch_size, pairs.size() );
+				auto R = parallelRanges( end - begin, [&]( size_t b, size_t e ) {
+					failure f;
+					f.index = firstNonTrivial( i, pairs, begin + b, begin + e, f.residue, f.level );
+					if( f.index == begin + e )
+						f.index = pairs.size();
+					return f;
+				} );
+				for( failure& f : R ) {
+					if( f.index < pairs.size() ) {
+						found = f.index;
+						j = f.level;
+						h = std::move( f.residue );
+						break;
+					}
+				}
+			}
+		} else
+			found = firstNonTrivial( i, pairs, 0, pairs.size(), h, j );
+		if( found == pairs.size() ) {
+			L[i].checked_points = L[i].orbit.size();
+			L[i].checked_generators = L[i].generators.size();
+			continue;
+		}
+		if( j == L.size() ) {
+			addBasePointMovedBy( h );
+		}
+		addGenerator( h, i + 1, j );
+		if( exceeds( bound ) )
+			return;
+		// resume at the lowest level that changed
+		i = j + 1;
+	}
+}
+
+bool StabilizerChain::reached( const natural& order ) const {
+	return not order.isZero() and exactOrder() >= order;
+}
+
+bool StabilizerChain::exceeds( const natural& bound ) const {
+	// the logarithms decide unless they are close
+	if( bound.isZero() or log2Order() < bound.log2() - 1 )
+		return false;
+	return exactOrder() >= bound;
+}
+
+void StabilizerChain::randomize( const StabilizerChainOptions& options ) {
+	if( L.empty() )
+		return;
+	// the first level holds the generators of the whole group
+	std::vector<Permutation> generators;
+	for( int g : L[0].generators )
+		generators.emplace_back( S[g] );
+	ProductReplacement R( generators, options.seed );
+	Permutation h( 0 );
+	for( int streak = 0; streak < options.sifts and not reached( options.order ) and not exceeds( options.bound ); ) {
+		h = R.next();
+		size_t j = sift( h );
+		if( j == L.size() and h.isIdentity() ) {
+			++streak;
+			continue;
+		}
+		streak = 0;
+		if( j == L.size() ) {
+			addBasePointMovedBy( h );
+		}
+		// the first level already holds the whole orbit, so h fixes its base point
+		addGenerator( h, 1, j );
+	}
+}
+
+void StabilizerChain::create( const std::vector<Permutation>& generators, size_t d, const std::vector<int>& base, const StabilizerChainOptions& options ) {
+	clear();
+	n = d;
+	S.reset( n );
+	Sinv.reset( n );
+	choosePriority( generators, options );
+	std::vector<bool> used( n, false );
+	for( int b : base ) {
+		if( not used[b] )
+			addBasePoint( b );
+		used[b] = true;
+	}
+	extend( generators, options );
+}
+
+void StabilizerChain::extend( const std::vector<Permutation>& generators, const StabilizerChainOptions& options ) {
+	bool changed = false;
+	for( const Permutation& sigma : generators ) {
+		if( sigma.isIdentity() or contains( sigma ) )
+			continue;
+		size_t i = 0;
+		while( i < L.size() and sigma( L[i].point ) == L[i].point )
+			++i;
+		if( i == L.size() ) {
+			addBasePointMovedBy( sigma );
+		}
+		addGenerator( sigma, 0, i );
+		changed = true;
+	}
+	if( not changed or exceeds( options.bound ) )
+		return;
+	if( options.randomized ) {
+		randomize( options );
+		if( not options.verify or reached( options.order ) or exceeds( options.bound ) )
+			return;
+	}
+	close( options.parallel, options.bound );
+}
+
+bool StabilizerChain::contains( const Permutation& sigma ) const {
+	if( sigma.degree() != n )
+		return false;
+	Permutation tau( sigma );
+	return sift( tau ) == L.size() and tau.isIdentity();
+}
+
+bool StabilizerChain::containsAll( const std::vector<Permutation>& P ) const {
+	if( P.size() < batch_size ) {
+		std::vector<char> member = siftAll( P, 0, P.size(), true );
+		return std::find( member.begin(), member.end(), 0 ) == member.end();
+	}
+	auto R = parallelRanges( P.size(), [&]( size_t begin, size_t end ) {
+		std::vector<char> member = siftAll( P, begin, end, true );
+		return std::find( member.begin(), member.end(), 0 ) == member.end();
+	} );
+	return std::find( R.begin(), R.end(), false ) == R.end();
+}
+
+std::vector<bool> StabilizerChain::containsMask( const std::vector<Permutation>& P ) const {
+	std::vector<std::vector<char>> R;
+	if( P.size() < batch_size )
+		R.push_back( siftAll( P, 0, P.size(), false ) );
+	else
+		R = parallelRanges( P.size(), [&]( size_t begin, size_t end ) {
+			return siftAll( P, begin, end, false );
+		} );
+	std::vector<bool> mask;
+	mask.reserve( P.size() );
+	for( const auto& member : R )
+		mask.insert( mask.end(), member.begin(), member.end() );
+	return mask;
+}
+
+Permutation StabilizerChain::find( const Permutation& sigma ) const {
+	Permutation tau( sigma );
+	sift( tau );
+	return tau;
+}
+
+bool StabilizerChain::isGiant() const {
+	if( n <= 2 )
+		return true;
+	// a giant is transitive, which rules out most groups without big integers
+	if( L.empty() or int( L[0].orbit.size() ) != n )
+		return false;
+	return exactOrder() * natural( 2 ) >= factorial( n );
+}
+
+__int128_t StabilizerChain::order() const {
+	return __int128_t( exactOrder() );
+}
+
+natural StabilizerChain::exactOrder() const {
+	natural r( 1 );
+	for( const level& l : L )
+		r *= natural( l.orbit.size() );
+	return r;
+}
+
+double StabilizerChain::log2Order() const {
+	double r = 0;
+	for( const level& l : L )
+		r += std::log2( l.orbit.size() );
+	return r;
+}
+
+bool StabilizerChain::orderAtLeast( const natural& bound ) const {
+	return bound.isZero() or exceeds( bound );
+}
+
+std::vector<int> StabilizerChain::base() const {
+	std::vector<int> B;
+	B.reserve( L.size() );
+	for( const level& l : L )
+		B.push_back( l.point );
+	return B;
+}
+
+const std::vector<int>& StabilizerChain::basicOrbit( size_t i ) const {
+	return L[i].orbit;
+}
+
+std::vector<Permutation> StabilizerChain::stabilizerGenerators( size_t i ) const {
+	std::vector<Permutation> gens;
+	if( i < L.size() )
+		for( int g : L[i].generators )
+			gens.emplace_back( S[g] );
+	return gens;
+}
+
+StabilizerChain StabilizerChain::stabilizer( size_t k ) const {
+	StabilizerChain C;
+	C.n = n;
+	C.priority = priority;
+	C.S.reset( n );
+	C.Sinv.reset( n );
+	// the deeper levels may use generators that level k does not, so all of theirs are kept
+	std::vector<int> slot( S.size(), -1 );
+	for( size_t i = k; i < L.size(); ++i )
+		for( int g : L[i].generators )
+			if( slot[g] < 0 ) {
+				slot[g] = C.S.push( S[g] );
+				C.Sinv.push( Sinv[g] );
+			}
+	for( size_t i = k; i < L.size(); ++i ) {
+		C.L.push_back( L[i] );
+		level& l = C.L.back();
+		for( int& g : l.generators )
+			g = slot[g];
+		for( int& g : l.schreier )
+			if( g >= 0 )
+				g = slot[g];
+	}
+	return C;
+}
+
+Permutation StabilizerChain::transversal( size_t i, int x ) const {
+	Permutation u( 0 );
+	transversal( i, x, u );
+	return u;
+}
+
+bool StabilizerChain::hasBaseImage( const std::vector<int>& images ) const {
+	if( images.size() > L.size() )
+		return false;
+	// sifts the unknown element g^-1 as sift does, so that w maps images[j] to the base point j
+	Permutation w( n );
+	for( size_t i = 0; i < images.size(); ++i ) {
+		const level& l = L[i];
+		int x = w( images[i] );
+		if( l.schreier[x] == -1 )
+			return false;
+		for( int g = l.schreier[x]; g != -2; g = l.schreier[x] ) {
+			w.leftMultiplyInPlace( Sinv[g] );
+			x = Sinv[g]( x );
+		}
+	}
+	return true;
+}
+
+std::vector<int> StabilizerChain::minimalCosetImage( const Permutation& sigma ) const {
+	// the elements of sigma G with the least images of the first i base points are tau * G^(i),
+	// which map the base point of level i to the images of its basic orbit under tau
+	std::vector<int> images;
+	images.reserve( L.size() );
+	Permutation tau( sigma );
+	Permutation u( 0 );
+	for( size_t i = 0; i < L.size(); ++i ) {
+		const level& l = L[i];
+		int x = l.point;
+		for( int y : l.orbit )
+			if( tau( y ) < tau( x ) )
+				x = y;
+		images.push_back( tau( x ) );
+		if( x != l.point and i + 1 < L.size() ) {
+			transversal( i, x, u );
+			Permutation::composeInto( tau, tau, u );
+		}
+	}
+	return images;
+}
+
+std::vector<Permutation> StabilizerChain::listGenerators() const {
+	std::vector<Permutation> gens;
+	gens.reserve( S.size() );
+	for( size_t i = 0; i < S.size(); ++i )
+		gens.emplace_back( S[i] );
+	return gens;
+}
+
+bool StabilizerChain::operator!() const {
+	return n == 0;
+}
+
+void StabilizerChain::save( const std::string& path ) const {
+	BinaryWriter out( path, StructureKind::stabilizer_chain );
+	write( out );
+	out.close();
+}
+
+void StabilizerChain::load( const std::string& path ) {
+	BinaryReader in( path, StructureKind::stabilizer_chain );
+	read( in );
+}
+
+void StabilizerChain::write( BinaryWriter& out ) const {
+	out.write<int32_t>( n );
+	out.write( priority );
+	out.write<uint64_t>( L.size() );
+	for( const level& l : L ) {
+		out.write<int32_t>( l.point );
+		out.write<uint64_t>( l.checked_points );
+		out.write<uint64_t>( l.checked_generators );
+		out.write( l.generators );
+		out.write( l.orbit );
+		out.write( l.schreier );
+	}
+	out.write( S );
+	out.write( Sinv );
+}
+
+void StabilizerChain::read( BinaryReader& in ) {
+	clear();
+	n = in.read<int32_t>();
+	priority = in.readVector<int>();
+	L.resize( in.read<uint64_t>() );
+	for( level& l : L ) {
+		l.point = in.read<int32_t>();
+		l.checked_points = in.read<uint64_t>();
+		l.checked_generators = in.read<uint64_t>();
+		l.generators = in.readVector<int>();
+		l.orbit = in.readVector<int>();
+		l.schreier = in.readVector<int>();
+	}
+	in.read( S );
+	in.read( Sinv );
+}
+
+StabilizerChain::StabilizerChain() {
+	clear();
+}
+
+StabilizerChain::StabilizerChain( const std::vector<Permutation>& generators, size_t d, const std::vector<int>& base, const StabilizerChainOptions& options ) {
+	create( generators, d, base, options );
+}
+
+std::ostream& operator<<( std::ostream& os, const StabilizerChain& chain ) {
+	std::vector<int> B = chain.base();
+	std::vector<size_t> O;
+	for( size_t i = 0; i < B.size(); ++i )
+		O.push_back( chain.basicOrbit( i ).size() );
+	return os << B << O;
+}
+
+// ----------------------------------------------------------------------------
+
+namespace {
+	int smallestMovedPoint( const Permutation& sigma ) {
+		int i = 0;
+		while( sigma( i ) == i )
+			++i;
+		return i;
+	}
+}
+
+std::vector<Permutation> jerrumFilter( const std::vector<Permutation>& S, int n ) {
+	std::vector<Permutation> gens;               // kept generators, the edges of the forest
+	std::vector<std::vector<int>> incident( n ); // indices of the kept generators at each point
+	std::vector<int> parent_edge( n ), parent( n );
+	Permutation step( 0 );
+	auto other = [&]( int e, int x ) {
+		int i = smallestMovedPoint( gens[e] );
+		return x == i ? gens[e]( i ) : i;
+	};
+	for( Permutation g : S ) {
+		while( not g.isIdentity() ) {
+			int i = smallestMovedPoint( g );
+			int j = g( i );
+			// look for a path from j to i in the forest
+			std::fill( parent_edge.begin(), parent_edge.end(), -2 );
+			std::vector<int> queue( 1, j );
+			parent_edge[j] = -1;
+			for( size_t q = 0; q < queue.size() and parent_edge[i] == -2; ++q ) {
+				int x = queue[q];
+				for( int e : incident[x] ) {
+					int y = other( e, x );
+					if( parent_edge[y] == -2 ) {
+						parent_edge[y] = e;
+						parent[y] = x;
+						queue.push_back( y );
+					}
+				}
+			}
+			if( parent_edge[i] == -2 ) {
+				incident[i].push_back( gens.size() );
+				incident[j].push_back( gens.size() );
+				gens.push_back( std::move( g ) );
+				break;
+			}
+			// the cycle is i -> j followed by the path back from j to i, listed as (point, edge to next point)
+			std::vector<std::pair<int,int>> cycle;
+			cycle.emplace_back( i, -1 );
+			std::vector<std::pair<int,int>> path;
+			for( int x = i; x != j; x = parent[x] )
+				path.emplace_back( parent[x], parent_edge[x] );
+			std::reverse( path.begin(), path.end() );
+			cycle.insert( cycle.end(), path.begin(), path.end() );
+			size_t start = 0;
+			for( size_t t = 1; t < cycle.size(); ++t )
+				if( cycle[t].first < cycle[start].first )
+					start = t;
+			// multiply around the cycle from its smallest point m, so that h fixes m and all smaller points
+			Permutation h( n );
+			for( size_t t = 0; t < cycle.size(); ++t ) {
+				const auto& c = cycle[ ( start + t ) % cycle.size() ];
+				const Permutation& x = c.second < 0 ? g : gens[c.second];
+				if( smallestMovedPoint( x ) == c.first )
+					h.leftMultiplyInPlace( x );
+				else {
+					x.invertInto( step );
+					h.leftMultiplyInPlace( step );
+				}
+			}
+			// drop the edge leaving m; if it is a kept generator, g takes its place in the forest
+			int e = cycle[start].second;
+			if( e >= 0 ) {
+				for( int x : { smallestMovedPoint( gens[e] ), gens[e]( smallestMovedPoint( gens[e] ) ) } )
+					incident[x].erase( std::find( incident[x].begin(), incident[x].end(), e ) );
+				gens[e] = std::move( g );
+				incident[i].push_back( e );
+				incident[j].push_back( e );
+			}
+			g = std::move( h );
+		}
+	}
+	return gens;
+}
+
+std::vector<Permutation> randomSubproducts( const std::vector<Permutation>& S, int n, const natural& order, uint64_t seed ) {
+	// a random subproduct lies outside a proper subgroup with probability at least 1/2, so this many
+	// failures in a row mean that the subproducts already generate the group and the order is wrong
+	const int attempts = 64;
+	std::mt19937_64 rng( seed );
+	std::vector<Permutation> R;
+	StabilizerChain C;
+	C.create( R, n );
+	for( int failures = 0; C.exactOrder() != order; ) {
+		if( failures == attempts )
+			throw std::invalid_argument( "Generators do not generate a group of the given order" );
+		Permutation r( n );
+		for( const Permutation& sigma : S )
+			if( rng() & 1 )
+				r.leftMultiplyInPlace( sigma );
+		if( r.isIdentity() or C.contains( r ) ) {
+			++failures;
+			continue;
+		}
+		failures = 0;
+		R.push_back( r );
+		C.extend( { r } );
+	}
+	return R;
+}
+
+std::vector<Permutation> reduceGenerators( const std::vector<Permutation>& S, int n, GeneratorReduction method ) {
+	switch( method ) {
+		case GeneratorReduction::jerrum:
+			return jerrumFilter( S, n );
+		case GeneratorReduction::random_subproducts:
+			return randomSubproducts( S, n, StabilizerChain( S, n ).exactOrder() );
+		default:
+			return S;
+	}
+}
@@ -0,0 +1,291 @@
+#pragma once
+
+#include <vector>
+#include <iostream>
+#include <random>
+#include <cstdint>
+
+#include "permutation.h"
+#include "permutation_arena.h"
+#include "serialization.h"
+#include "ext.h"
+#include "multi.h"
+
+// random elements of the group generated by a list of permutations by product replacement
+// *************************************************************
+// The state consists of max(10,|S|) slots initialised with the
+// generators and an accumulator. Every step replaces a random
+// slot s_i by s_i * s_j^(+-1) or s_j^(+-1) * s_i and multiplies
+// the accumulator by the new s_i; the accumulator is returned.
+// *************************************************************
+class ProductReplacement {
+	std::vector<Permutation> slots;
+	Permutation accumulator;
+	Permutation scratch;
+	std::mt19937_64 rng;
+public:
+	// number of steps done before the first element is returned
+	static const int warm_up = 50;
+
+	// returns the next random element
+	const Permutation& next();
+
+	// constructs the generator, S must contain at least one permutation
+	ProductReplacement( const std::vector<Permutation>& S, uint64_t seed );
+};
+
+// rules for choosing a new base point among the points moved by a new strong generator
+enum class BaseStrategy {
+	first_moved,   // the smallest point
+	largest_orbit, // a point in the largest orbit of the group, smallest first
+	given_order    // the first point in StabilizerChainOptions::base_order, then the smallest
+};
+
+// methods to shrink a generating set, see reduceGenerators
+enum class GeneratorReduction {
+	none,               // keep the generators
+	random_subproducts, // random subproducts of the generators until they generate the group
+	jerrum              // Jerrum's filter, at most n-1 generators
+};
+
+// parameters for the construction of a StabilizerChain
+struct StabilizerChainOptions {
+	// build the chain with random Schreier-Sims instead of the deterministic algorithm
+	bool randomized = false;
+
+	// after a randomized build, check all Schreier generators so the result is certain
+	bool verify = true;
+
+	// stop the random phase after this many consecutive elements sift to the identity
+	int sifts = 20;
+
+	// order of the group when known beforehand, zero otherwise
+	// the construction stops as soon as the chain reaches it, without verification
+	natural order = 0;
+
+	// stop the construction as soon as the order is known to be at least bound, zero to build the whole chain
+	// a chain that stopped early encodes a subgroup, see StabilizerChain::orderAtLeast
+	natural bound = 0;
+
+	// seed of the random elements
+	uint64_t seed = 0x5eed;
+
+	// sift the Schreier generators of a level on THREADS threads, see multi.h
+	// the resulting chain is the same as without
+	bool parallel = false;
+
+	// choice of base points beyond the ones given to create
+	BaseStrategy base_strategy = BaseStrategy::first_moved;
+
+	// preferred order of base points for BaseStrategy::given_order, e.g. the orbits passed to ChainRule
+	std::vector<int> base_order;
+
+	// reduction of the generating sets of groups produced by SubgroupGenerator::subgroup
+	GeneratorReduction reduction = GeneratorReduction::none;
+};
+
+// base and strong generating set of a permutation group
+// *************************************************************
+// The chain is built with the deterministic Schreier-Sims
+// algorithm. Level i stores the base point b_i, the strong
+// generators fixing b_0,...,b_{i-1} and the orbit of b_i under
+// them as a Schreier vector: for every point x in the orbit it
+// holds a generator s with s^-1(x) closer to b_i. Transversal
+// elements are never stored, they are recovered by walking the
+// Schreier vector, so memory is O(n) per level plus the strong
+// generators. Orbits only grow and keep their labels, so the
+// Schreier generators checked before a level was extended do
+// not have to be checked again.
+// With StabilizerChainOptions::randomized the chain is first
+// built from random elements, which is correct with high
+// probability; the deterministic closure then only verifies it.
+// It answers the same queries as FHL<Permutation>.
+// *************************************************************
+class StabilizerChain {
+	struct level {
+		int point;                   // base point
+		std::vector<int> generators; // slots of the strong generators fixing earlier base points
+		std::vector<int> orbit;      // orbit of the base point
+		std::vector<int> schreier;   // slot of the generator labelling each point, -1 outside the orbit, -2 for the base point
+		size_t checked_points;       // the Schreier generators of the first checked_points orbit points
+		size_t checked_generators;   // and first checked_generators generators are known to sift
+	};
+	int n;
+	std::vector<level> L;
+	std::vector<int> priority; // all points, in the order in which they are tried as new base point
+	PermutationArena S;    // strong generators
+	PermutationArena Sinv; // their inverses, in the same slots
+
+	// adds sigma as strong generator to the levels first,...,last
+	void addGenerator( const Permutation& sigma, size_t first, size_t last );
+
+	// appends a level with the given base point
+	void addBasePoint( int b );
+
+	// sets the order in which points become base points
+	void choosePriority( const std::vector<Permutation>& S, const StabilizerChainOptions& options );
+
+	// appends a level whose base point is the first point moved by sigma in priority order
+	void addBasePointMovedBy( const Permutation& sigma );
+
+	// extends the orbit and Schreier vector of a level by its generators from index first on
+	// the labels of points already in the orbit are kept
+	void extendOrbit( level& l, size_t first ) const;
+
+	// exchanges the base points of levels i and i+1, keeping the other levels (Holt's BASESWAP)
+	// returns false, leaving the levels as they were, when the second level cannot reach its size, which
+	// happens only when the chain is incomplete
+	bool swapBasePoints( size_t i );
+
+	// makes the base start with the points of prefix, by adding trivial levels and swapping adjacent base points
+	// further base points are the candidates, in order, that the stabiliser of the points placed before them moves
+	// the candidates must include a base; returns false when a swap failed
+	bool arrangeBase( const std::vector<int>& prefix, const std::vector<int>& candidates );
+
+	// rebuilds the chain from its strong generators with a base starting with prefix, further points in priority order
+	void rebuild( const std::vector<int>& prefix );
+
+	// stores the transversal element mapping the base point of level i to x in u
+	void transversal( size_t i, int x, Permutation& u ) const;
+
+	// strips sigma through the levels from first on, in place
+	// returns the level where it dropped out, or the number of levels when it sifted through
+	size_t sift( Permutation& sigma, size_t first = 0 ) const;
+
+	// sifts P[begin,end) together, one level at a time, and returns for each whether it is an element
+	// with stop=true it returns as soon as one of them is not, with the remaining entries false
+	std::vector<char> siftAll( const std::vector<Permutation>& P, size_t begin, size_t end, bool stop ) const;
+
+	// sifts the Schreier generators of level i given by pairs[begin,end) as (orbit index, generator index)
+	// returns the index of the first one that does not sift to the identity, or end
+	// its residue is left in h and the level where it dropped out in j
+	size_t firstNonTrivial( size_t i, const std::vector<std::pair<size_t,size_t>>& pairs, size_t begin, size_t end, Permutation& h, size_t& j ) const;
+
+	// runs Schreier-Sims until every Schreier generator sifts to the identity, or the order reaches bound
+	// with parallel=true the Schreier generators of a level are sifted concurrently, with the same result
+	void close( bool parallel, const natural& bound );
+
+	// sifts random elements of the group until the stopping rule of the options is met
+	void randomize( const StabilizerChainOptions& options );
+
+	// checks whether the given order is non-zero and the product of the basic orbit sizes is at least that order
+	bool reached( const natural& order ) const;
+
+	// checks whether bound is non-zero and the product of the basic orbit sizes is at least bound
+	bool exceeds( const natural& bound ) const;
+public:
+	// number of Schreier generators checked concurrently before looking for a failure
+	static const size_t batch_size = 1024;
+
+	// returns the options used when none are given, changing them affects all later constructions
+	static StabilizerChainOptions& defaults();
+
+	// clears all data in the structure
+	void clear();
+
+	// initialises the structure using S as generators with degree d
+	// the base starts with the given points, further points are chosen as needed
+	void create( const std::vector<Permutation>& S, size_t d, const std::vector<int>& base = {}, const StabilizerChainOptions& options = defaults() );
+
+	// extends the group encoded by this structure by the generators S
+	// only the new generators are sifted in, and closure only revisits Schreier generators that are new
+	void extend( const std::vector<Permutation>& S, const StabilizerChainOptions& options = defaults() );
+
+	// changes the base to start with the given points, keeping the group
+	// the points are moved up by swapping adjacent base points, which only recomputes the two levels involved
+	// further base points keep the order of the current base, or follow the priority of the base strategy of options
+	// a swap can only fail on an incomplete Monte Carlo chain, which is then rebuilt from its strong generators
+	void changeBase( const std::vector<int>& prefix );
+	void changeBase( const std::vector<int>& prefix, const StabilizerChainOptions& options );
+
+	// checks whether sigma is an element of the group encoded by this structure
+	bool contains( const Permutation& sigma ) const;
+
+	// checks membership of all permutations in P at once, concurrently for at least batch_size of them
+	// the permutations are sifted together level by level, so every level is walked once per batch
+	bool containsAll( const std::vector<Permutation>& P ) const;
+	std::vector<bool> containsMask( const std::vector<Permutation>& P ) const;
+
+	// returns the residue of sigma after sifting, the identity when sigma is in the group
+	Permutation find( const Permutation& sigma ) const;
+
+	// checks whether the group encoded by this structure is a giant
+	bool isGiant() const;
+
+	// computes the order of the group encoded by this structure
+	// order() saturates when the order does not fit, exactOrder() does not
+	__int128_t order() const;
+	natural exactOrder() const;
+
+	// returns the binary logarithm of the order
+	double log2Order() const;
+
+	// checks whether the order is at least bound
+	// the basic orbits of an incomplete chain are contained in the real ones, so a chain built with
+	// StabilizerChainOptions::bound answers this correctly even when it stopped early
+	bool orderAtLeast( const natural& bound ) const;
+
+	// returns the base points
+	std::vector<int> base() const;
+
+	// returns the orbit of the i-th base point under the i-th stabiliser
+	const std::vector<int>& basicOrbit( size_t i ) const;
+
+	// returns the strong generators fixing the first i base points, which generate their pointwise stabiliser
+	// the list is empty when that stabiliser is trivial
+	std::vector<Permutation> stabilizerGenerators( size_t i ) const;
+
+	// returns the chain of the pointwise stabiliser of the first k base points, made of the levels from k on
+	StabilizerChain stabilizer( size_t k ) const;
+
+	// returns the transversal element of level i mapping the base point to x, which must lie in the basic orbit
+	Permutation transversal( size_t i, int x ) const;
+
+	// checks whether the group has an element mapping the first images.size() base points to images
+	bool hasBaseImage( const std::vector<int>& images ) const;
+
+	// returns the lexicographically least images of the base points under the elements of the left coset sigma G
+	// two permutations get the same images exactly when they lie in the same left coset
+	std::vector<int> minimalCosetImage( const Permutation& sigma ) const;
+
+	// returns the strong generating set
+	std::vector<Permutation> listGenerators() const;
+
+	// checks whether the structure is empty
+	bool operator!() const;
+
+	// writes the structure to a file, see serialization.h
+	// a loaded chain uses the strong generators in the mapped file until it is extended
+	void save( const std::string& path ) const;
+	void load( const std::string& path );
+	void write( BinaryWriter& out ) const;
+	void read( BinaryReader& in );
+
+	// constructs the structure
+	StabilizerChain();
+
+	// constructs the structure, equivalent to {StabilizerChain X(), X.create( S, d, base, options )}
+	StabilizerChain( const std::vector<Permutation>& S, size_t d, const std::vector<int>& base = {}, const StabilizerChainOptions& options = defaults() );
+};
+
+// returns at most n-1 generators of the group generated by S, using Jerrum's filter
+// *************************************************************
+// Every kept generator g is an edge between its smallest moved
+// point i and g(i), and the edges form a forest. A generator that
+// closes a cycle is multiplied around the cycle, starting at its
+// smallest point m, which gives an element fixing all points up
+// to m. It replaces one of the generators at m and is filtered in
+// turn, so the generated group never changes.
+// *************************************************************
+std::vector<Permutation> jerrumFilter( const std::vector<Permutation>& S, int n );
+
+// returns random subproducts of S that generate the same group, of the given order
+// every subproduct is kept when it enlarges the group, so about log2 of the order are returned
+// throws std::invalid_argument when many subproducts in a row do not enlarge the group before it reaches the order
+std::vector<Permutation> randomSubproducts( const std::vector<Permutation>& S, int n, const natural& order, uint64_t seed = 0x5eed );
+
+// returns a smaller generating set for the group generated by S with the given method
+std::vector<Permutation> reduceGenerators( const std::vector<Permutation>& S, int n, GeneratorReduction method );
+
+// print the base and basic orbit sizes to an output stream
+std::ostream& operator<<( std::ostream& os, const StabilizerChain& chain );